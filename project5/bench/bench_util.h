@@ -0,0 +1,166 @@
+#ifndef __BENCH_UTIL_H__
+#define __BENCH_UTIL_H__
+
+#include "bpt.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ *  Helpers shared by the benchmarks and the tests.
+ *  - Every program checks what it reads, and exits with a non-zero status on a wrong result.
+ *  - The parameters are given as name=value arguments, and the defaults finish in seconds.
+ *  - The table files are made in the current directory and removed at the end,
+ *    so run them from a directory on the device to be measured.
+ */
+
+/*
+ *  Print the message and exit with a non-zero status.
+ */
+static inline void fail(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	fputs("FAIL: ", stderr);
+	vfprintf(stderr, format, args);
+	fputc('\n', stderr);
+	va_end(args);
+	exit(1);
+}
+
+/*
+ *  Return the value of the name=value argument, or def if it is not given.
+ */
+static inline long arg(int argc, char** argv, const char* name, long def)
+{
+	const size_t len = strlen(name);
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], name, len) == 0 && argv[i][len] == '=')
+			return strtol(argv[i] + len + 1, NULL, 0);
+	}
+	return def;
+}
+
+/*
+ *  Monotonic time in nanoseconds
+ */
+static inline uint64_t now_ns(void)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ *  xorshift64*: a fast random number generator, one per thread
+ */
+struct Random
+{
+	uint64_t state;
+
+	explicit Random(uint64_t seed)
+		:state(seed * 0x9E3779B97F4A7C15ull + 1)
+	{
+
+	};
+
+	uint64_t next()
+	{
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return state * 0x2545F4914F6CDD1Dull;
+	};
+
+	/* A number in [0, n) */
+	int64_t below(int64_t n)
+	{
+		return static_cast<int64_t>(next() % static_cast<uint64_t>(n));
+	};
+};
+
+/*
+ *  The record of a key: its first value is the key itself, and the second one is its complement.
+ */
+static inline void record_of(int64_t key, int64_t values[2])
+{
+	values[0] = key;
+	values[1] = ~key;
+}
+
+/*
+ *  Look up the key and check its record. Return false if it is not found.
+ */
+static inline bool find_checked(int table_id, int64_t key)
+{
+	int64_t* values = find(table_id, key);
+	if (values == NULL)
+		return false;
+	if (values[0] != key || values[1] != ~key)
+		fail("wrong record for key %lld", (long long)key);
+	delete[] values;
+	return true;
+}
+
+/*
+ *  Remove the table file, and the working set saved next to it by close_table().
+ */
+static inline void remove_table(const char* path)
+{
+	remove(path);
+	remove((std::string(path) + WARM_FILE_SUFFIX).c_str());
+}
+
+/*
+ *  Make a new table of the keys 0 .. num_keys - 1 in a shuffled order, and return its table id.
+ */
+static inline int load_table(const char* path, int64_t num_keys, table_mode mode = BUFFERED)
+{
+	remove_table(path);
+	const int table_id = open_table(const_cast<char*>(path), 3, mode);
+	if (table_id <= 0)
+		fail("open_table(%s) = %d", path, table_id);
+	set_durability(table_id, NO_SYNC);
+
+	// A stride coprime to num_keys visits every key once, out of order.
+	int64_t stride = 7919;
+	while (num_keys % stride == 0)
+		stride += 2;
+
+	int64_t values[2];
+	for (int64_t i = 0, key = 0; i < num_keys; i++, key = (key + stride) % num_keys) {
+		record_of(key, values);
+		if (insert(table_id, key, values) != 0)
+			fail("insert(%lld) failed", (long long)key);
+	}
+	return table_id;
+}
+
+/*
+ *  Run the function on each of the given number of threads, with the thread number, and wait for them.
+ */
+static inline void run_threads(int num_threads, const std::function<void(int)>& body)
+{
+	std::vector<std::thread> threads;
+	for (int i = 0; i < num_threads; i++)
+		threads.emplace_back(body, i);
+	for (auto& thread : threads)
+		thread.join();
+}
+
+/*
+ *  Hit ratio in percent of the buffer pool statistics
+ */
+static inline double hit_ratio(const buffer_stats& stats)
+{
+	const uint64_t total = stats.hits + stats.misses;
+	return total == 0 ? 0.0 : 100.0 * stats.hits / total;
+}
+
+#endif /* __BENCH_UTIL_H__ */
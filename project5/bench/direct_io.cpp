@@ -0,0 +1,58 @@
+#include "bench_util.h"
+
+/*
+ *  Random lookups on a table larger than the pool, opened with and without DIRECT_IO
+ *  A miss reads the page from the OS page cache in BUFFERED mode, and from the device in DIRECT_IO mode,
+ *  where the buffer pool is the only cache of the table. (A file system without O_DIRECT opens it BUFFERED.)
+ *  - keys: the number of keys in the table
+ *  - buffers: the size of the pool
+ *  - ops: the number of lookups per mode
+ */
+int main(int argc, char** argv)
+{
+	const int64_t num_keys = arg(argc, argv, "keys", 200000);
+	const int buf_num = arg(argc, argv, "buffers", 1024);
+	const long num_ops = arg(argc, argv, "ops", 100000);
+	const char* path = "bench_direct_io.db";
+	const struct { table_mode mode; const char* name; } modes[] = {
+		{ BUFFERED, "BUFFERED" }, { DIRECT_IO, "DIRECT_IO" }
+	};
+
+	// The figures are printed here, instead of the statistics dump at shutdown_db().
+	set_buffer_stats_dump(false);
+
+	// The table is made once, and read in each mode.
+	if (init_db(buf_num) != 0)
+		fail("init_db");
+	close_table(load_table(path, num_keys));
+	shutdown_db();
+
+	printf("%-10s %12s %10s %10s\n", "mode", "ns/lookup", "hit %", "misses");
+	for (const auto& mode : modes) {
+		if (init_db(buf_num) != 0)
+			fail("init_db");
+		const int table_id = open_table(const_cast<char*>(path), 3, mode.mode);
+		if (table_id <= 0)
+			fail("open_table(%s) = %d", path, table_id);
+
+		reset_buffer_stats();
+		Random random(1);
+		const uint64_t start = now_ns();
+		for (long i = 0; i < num_ops; i++) {
+			const int64_t key = random.below(num_keys);
+			if (!find_checked(table_id, key))
+				fail("key %lld is missing in %s mode", (long long)key, mode.name);
+		}
+		const uint64_t elapsed = now_ns() - start;
+
+		buffer_stats stats;
+		get_buffer_stats(&stats);
+		printf("%-10s %12.1f %10.2f %10llu\n", mode.name, (double)elapsed / num_ops,
+			hit_ratio(stats), (unsigned long long)stats.misses);
+
+		close_table(table_id);
+		shutdown_db();
+	}
+	remove_table(path);
+	return 0;
+}
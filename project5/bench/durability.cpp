@@ -0,0 +1,65 @@
+#include "bench_util.h"
+
+/*
+ *  Insert throughput in each durability mode
+ *  The pool is small, so the inserts write back pages all along:
+ *  FULL_SYNC syncs every write, CHECKPOINT_SYNC only the checkpoint at the end, and NO_SYNC never.
+ *  Every table is read back after it is reopened.
+ *  - keys: the number of keys inserted
+ *  - buffers: the size of the pool
+ */
+int main(int argc, char** argv)
+{
+	const int64_t num_keys = arg(argc, argv, "keys", 20000);
+	const int buf_num = arg(argc, argv, "buffers", 256);
+	const char* path = "bench_durability.db";
+	const struct { durability_mode mode; const char* name; } modes[] = {
+		{ FULL_SYNC, "FULL_SYNC" }, { CHECKPOINT_SYNC, "CHECKPOINT_SYNC" }, { NO_SYNC, "NO_SYNC" }
+	};
+
+	// The figures are printed here, instead of the statistics dump at shutdown_db().
+	set_buffer_stats_dump(false);
+
+	printf("%-16s %14s %12s\n", "mode", "inserts/s", "writes");
+	for (const auto& mode : modes) {
+		if (init_db(buf_num) != 0)
+			fail("init_db");
+		remove_table(path);
+		int table_id = open_table(const_cast<char*>(path), 3);
+		if (table_id <= 0)
+			fail("open_table(%s) = %d", path, table_id);
+		if (set_durability(table_id, mode.mode) != 0)
+			fail("set_durability(%s)", mode.name);
+
+		// The keys go in out of order, so the writes land all over the file.
+		int64_t stride = 7919, values[2];
+		while (num_keys % stride == 0)
+			stride += 2;
+
+		reset_buffer_stats();
+		const uint64_t start = now_ns();
+		for (int64_t i = 0, key = 0; i < num_keys; i++, key = (key + stride) % num_keys) {
+			record_of(key, values);
+			if (insert(table_id, key, values) != 0)
+				fail("insert(%lld) failed", (long long)key);
+		}
+		if (checkpoint(table_id) != 0)
+			fail("checkpoint");
+		const uint64_t elapsed = now_ns() - start;
+
+		buffer_stats stats;
+		get_buffer_stats(&stats);
+		printf("%-16s %14.0f %12llu\n", mode.name, num_keys * 1e9 / elapsed, (unsigned long long)stats.write_backs);
+
+		close_table(table_id);
+		table_id = open_table(const_cast<char*>(path), 3);
+		for (int64_t key = 0; key < num_keys; key++) {
+			if (!find_checked(table_id, key))
+				fail("key %lld is lost in %s", (long long)key, mode.name);
+		}
+		close_table(table_id);
+		shutdown_db();
+		remove_table(path);
+	}
+	return 0;
+}
@@ -0,0 +1,89 @@
+#include "bench_util.h"
+
+/*
+ *  Random lookups over a large resident table, with each backing of the page frames
+ *  The lookups jump across the whole pool, so they miss the TLB unless the frames are backed by huge pages.
+ *  (Run it under "perf stat -e dTLB-load-misses,cache-misses" to count the misses themselves.)
+ *  EXPLICIT_HUGE_PAGES falls back to the other pages unless huge pages are reserved. (vm.nr_hugepages)
+ *  - keys: the number of keys in the table
+ *  - buffers: the size of the pool, which must hold the whole table
+ *  - ops: the number of lookups per backing
+ */
+
+/* The number of free reserved huge pages, from /proc/meminfo */
+static long free_huge_pages(void)
+{
+	FILE* meminfo = fopen("/proc/meminfo", "r");
+	char line[256];
+	long num_free = 0;
+
+	if (meminfo == NULL)
+		return 0;
+	while (fgets(line, sizeof(line), meminfo) != NULL) {
+		if (sscanf(line, "HugePages_Free: %ld", &num_free) == 1)
+			break;
+	}
+	fclose(meminfo);
+	return num_free;
+}
+
+int main(int argc, char** argv)
+{
+	const int64_t num_keys = arg(argc, argv, "keys", 500000);
+	const int buf_num = arg(argc, argv, "buffers", 65536);
+	const long num_ops = arg(argc, argv, "ops", 2000000);
+	const char* path = "bench_frame_backing.db";
+	const struct { frame_backing backing; const char* name; } backings[] = {
+		{ NORMAL_PAGES, "NORMAL_PAGES" },
+		{ TRANSPARENT_HUGE_PAGES, "TRANSPARENT_HUGE_PAGES" },
+		{ EXPLICIT_HUGE_PAGES, "EXPLICIT_HUGE_PAGES" }
+	};
+
+	// The figures are printed here, instead of the statistics dump at shutdown_db().
+	set_buffer_stats_dump(false);
+
+	// The table is made once, and read into each pool.
+	if (init_db(buf_num) != 0)
+		fail("init_db");
+	close_table(load_table(path, num_keys));
+	shutdown_db();
+
+	printf("%-24s %12s\n", "backing", "ns/lookup");
+	for (const auto& backing : backings) {
+		// Taken before the pool takes them
+		const long num_huge_pages = free_huge_pages();
+		if (init_db(buf_num, DEFAULT_NUM_OF_PARTITIONS, LRU, backing.backing) != 0)
+			fail("init_db");
+		const int table_id = open_table(const_cast<char*>(path), 3);
+		if (table_id <= 0)
+			fail("open_table(%s) = %d", path, table_id);
+
+		// Read the whole table into the pool.
+		for (int64_t key = 0; key < num_keys; key++) {
+			if (!find_checked(table_id, key))
+				fail("key %lld is missing", (long long)key);
+		}
+
+		reset_buffer_stats();
+		Random random(1);
+		const uint64_t start = now_ns();
+		for (long i = 0; i < num_ops; i++) {
+			const int64_t key = random.below(num_keys);
+			if (!find_checked(table_id, key))
+				fail("key %lld is missing", (long long)key);
+		}
+		const uint64_t elapsed = now_ns() - start;
+
+		buffer_stats stats;
+		get_buffer_stats(&stats);
+		if (stats.misses != 0)
+			fail("%llu misses: the table doesn't fit in %d buffers", (unsigned long long)stats.misses, buf_num);
+		printf("%-24s %12.1f%s\n", backing.name, (double)elapsed / num_ops,
+			backing.backing == EXPLICIT_HUGE_PAGES && num_huge_pages == 0 ? " (no huge pages reserved)" : "");
+
+		close_table(table_id);
+		shutdown_db();
+	}
+	remove_table(path);
+	return 0;
+}
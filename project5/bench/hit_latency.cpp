@@ -0,0 +1,57 @@
+#include "bench_util.h"
+
+/*
+ *  Hit latency as the buffer pool grows
+ *  The same hot keys, which fit in the smallest pool, are looked up in pools of 128 up to max buffers.
+ *  A hit is a lookup in the page directory, so its cost must stay flat as the pool grows.
+ *  - keys: the number of hot keys (default 2000, a few dozen pages)
+ *  - ops: the number of lookups per pool size
+ *  - max: the largest pool (default 1M buffers)
+ */
+int main(int argc, char** argv)
+{
+	const int64_t num_keys = arg(argc, argv, "keys", 2000);
+	const long num_ops = arg(argc, argv, "ops", 2000000);
+	const long max_buf = arg(argc, argv, "max", 1 << 20);
+	const char* path = "bench_hit_latency.db";
+
+	// The figures are printed here, instead of the statistics dump at shutdown_db().
+	set_buffer_stats_dump(false);
+
+	printf("%10s %12s %10s\n", "buffers", "ns/lookup", "hit %");
+	for (long buf_num = 128; buf_num <= max_buf; buf_num *= 8) {
+		if (init_db(buf_num) != 0)
+			fail("init_db(%ld)", buf_num);
+		const int table_id = load_table(path, num_keys);
+
+		// Warm up, so that every hot page is resident.
+		for (int64_t key = 0; key < num_keys; key++) {
+			if (!find_checked(table_id, key))
+				fail("key %lld is missing", (long long)key);
+		}
+
+		reset_buffer_stats();
+		Random random(buf_num);
+		const uint64_t start = now_ns();
+		for (long i = 0; i < num_ops; i++) {
+			const int64_t key = random.below(num_keys);
+			if (!find_checked(table_id, key))
+				fail("key %lld is missing", (long long)key);
+		}
+		const uint64_t elapsed = now_ns() - start;
+
+		buffer_stats stats;
+		get_buffer_stats(&stats);
+		if (stats.misses != 0)
+			fail("%llu misses in a pool of %ld buffers", (unsigned long long)stats.misses, buf_num);
+		printf("%10ld %12.1f %10.2f\n", buf_num, (double)elapsed / num_ops, hit_ratio(stats));
+
+		close_table(table_id);
+		shutdown_db();
+		remove_table(path);
+		// The largest pool is measured even if it is not a power of 8 times the smallest.
+		if (buf_num < max_buf && buf_num * 8 > max_buf)
+			buf_num = max_buf / 8;
+	}
+	return 0;
+}
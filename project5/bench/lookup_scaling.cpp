@@ -0,0 +1,49 @@
+#include "bench_util.h"
+
+/*
+ *  Scaling of the point lookups from 1 up to 64 threads
+ *  The table fits in the pool, so the lookups descend optimistically without latching the pages,
+ *  and the threads only share cache lines for reading.
+ *  - keys: the number of keys in the table
+ *  - ops: the number of lookups per thread
+ *  - threads: the largest number of threads (doubled from 1)
+ */
+int main(int argc, char** argv)
+{
+	const int64_t num_keys = arg(argc, argv, "keys", 100000);
+	const long num_ops = arg(argc, argv, "ops", 100000);
+	const int max_threads = arg(argc, argv, "threads", 64);
+	const char* path = "bench_lookup_scaling.db";
+
+	// The figures are printed here, instead of the statistics dump at shutdown_db().
+	set_buffer_stats_dump(false);
+
+	if (init_db(num_keys / 8) != 0)
+		fail("init_db");
+	const int table_id = load_table(path, num_keys);
+
+	printf("%8s %14s %10s\n", "threads", "lookups/s", "speedup");
+	double base = 0;
+	for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+		const uint64_t start = now_ns();
+		run_threads(num_threads, [&](int id) {
+			Random random(id + 1);
+			for (long i = 0; i < num_ops; i++) {
+				const int64_t key = random.below(num_keys);
+				if (!find_checked(table_id, key))
+					fail("key %lld is missing", (long long)key);
+			}
+		});
+		const uint64_t elapsed = now_ns() - start;
+
+		const double rate = (double)num_ops * num_threads * 1e9 / elapsed;
+		if (num_threads == 1)
+			base = rate;
+		printf("%8d %14.0f %10.2f\n", num_threads, rate, rate / base);
+	}
+
+	close_table(table_id);
+	shutdown_db();
+	remove_table(path);
+	return 0;
+}
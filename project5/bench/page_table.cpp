@@ -0,0 +1,129 @@
+#include "bench_util.h"
+#include "page_table.h"
+
+#include <atomic>
+#include <pthread.h>
+#include <unordered_map>
+
+/*
+ *  Lookups in the lock-free page directory against a mutex-guarded hash map, at 1, 8 and 64 threads
+ *  A writer thread inserts and erases other keys all the while, as the misses of a partition do.
+ *  (The writer takes the latch in both cases, as the partition latch serializes the writers.)
+ *  - keys: the number of resident pages in the directory
+ *  - ops: the number of lookups per thread
+ */
+
+/* A block pointer to tell the entries apart, which is never dereferenced */
+static BufferBlock* block_of(uint64_t i)
+{
+	return reinterpret_cast<BufferBlock*>(static_cast<uintptr_t>(i + 1) * 64);
+}
+
+/* The key of a page of table 1, as the buffer manager makes it */
+static uint64_t key_of(uint64_t i)
+{
+	return (1ull << 56) | i;
+}
+
+/* The mutex-guarded directory */
+struct GuardedTable
+{
+	latch lock = PTHREAD_MUTEX_INITIALIZER;
+	std::unordered_map<uint64_t, BufferBlock*> map;
+
+	BufferBlock* find(uint64_t key)
+	{
+		pthread_mutex_lock(&lock);
+		auto it = map.find(key);
+		BufferBlock* block = it == map.end() ? nullptr : it->second;
+		pthread_mutex_unlock(&lock);
+		return block;
+	};
+};
+
+/*
+ *  Run the lookups on the given number of threads next to the writer, and return the lookups per second.
+ */
+template <typename Find, typename Insert, typename Erase>
+static double measure(int num_threads, uint64_t num_keys, long num_ops, Find find, Insert insert, Erase erase)
+{
+	std::atomic<int> num_running(num_threads);
+	uint64_t elapsed = 0;
+
+	const uint64_t start = now_ns();
+	run_threads(num_threads + 1, [&](int id) {
+		if (id == num_threads) {
+			// Churn the keys beyond the resident ones until the readers are over.
+			for (uint64_t i = num_keys; num_running > 0; i = i + 1 < 2 * num_keys ? i + 1 : num_keys) {
+				insert(key_of(i), block_of(i));
+				erase(key_of(i));
+			}
+			return;
+		}
+
+		Random random(id + 1);
+		for (long n = 0; n < num_ops; n++) {
+			const uint64_t i = random.below(num_keys);
+			if (find(key_of(i)) != block_of(i))
+				fail("page %llu is not found", (unsigned long long)i);
+		}
+		if (--num_running == 0)
+			elapsed = now_ns() - start;
+	});
+	return (double)num_ops * num_threads * 1e9 / elapsed;
+}
+
+int main(int argc, char** argv)
+{
+	const uint64_t num_keys = arg(argc, argv, "keys", 65536);
+	const long num_ops = arg(argc, argv, "ops", 500000);
+
+	PageTable directory;
+	latch writer_lock = PTHREAD_MUTEX_INITIALIZER;
+	directory.reserve(2 * num_keys);
+	GuardedTable guarded;
+	guarded.map.reserve(2 * num_keys);
+	for (uint64_t i = 0; i < num_keys; i++) {
+		directory.insert(key_of(i), block_of(i));
+		guarded.map[key_of(i)] = block_of(i);
+	}
+
+	printf("%8s %16s %16s\n", "threads", "lock-free /s", "mutex /s");
+	for (int num_threads : { 1, 8, 64 }) {
+		const double lock_free = measure(num_threads, num_keys, num_ops,
+			[&](uint64_t key) {
+				// A page moved by an erase may be missed, and is looked up again under the latch, as get_frame() does.
+				BufferBlock* block = directory.find(key);
+				if (block == nullptr) {
+					pthread_mutex_lock(&writer_lock);
+					block = directory.find(key);
+					pthread_mutex_unlock(&writer_lock);
+				}
+				return block;
+			},
+			[&](uint64_t key, BufferBlock* block) {
+				pthread_mutex_lock(&writer_lock);
+				directory.insert(key, block);
+				pthread_mutex_unlock(&writer_lock);
+			},
+			[&](uint64_t key) {
+				pthread_mutex_lock(&writer_lock);
+				directory.erase(key);
+				pthread_mutex_unlock(&writer_lock);
+			});
+		const double mutex = measure(num_threads, num_keys, num_ops,
+			[&](uint64_t key) { return guarded.find(key); },
+			[&](uint64_t key, BufferBlock* block) {
+				pthread_mutex_lock(&guarded.lock);
+				guarded.map[key] = block;
+				pthread_mutex_unlock(&guarded.lock);
+			},
+			[&](uint64_t key) {
+				pthread_mutex_lock(&guarded.lock);
+				guarded.map.erase(key);
+				pthread_mutex_unlock(&guarded.lock);
+			});
+		printf("%8d %16.0f %16.0f\n", num_threads, lock_free, mutex);
+	}
+	return 0;
+}
@@ -0,0 +1,56 @@
+#include "bench_util.h"
+
+#include <algorithm>
+
+/*
+ *  Cost of the hit path of each replacement policy under concurrent lookups
+ *  The whole table fits in the pool, so every lookup is a hit, and the policy only records the accesses.
+ *  LRU moves the block under the partition latch on every unpin, while CLOCK only sets its reference bit.
+ *  - keys: the number of keys in the table
+ *  - ops: the number of lookups per thread
+ *  - threads: the largest number of threads (doubled from 1)
+ */
+int main(int argc, char** argv)
+{
+	const int64_t num_keys = arg(argc, argv, "keys", 100000);
+	const long num_ops = arg(argc, argv, "ops", 200000);
+	const int max_threads = arg(argc, argv, "threads", std::max(8u, std::thread::hardware_concurrency()));
+	const char* path = "bench_policy_hit_path.db";
+	const struct { policy_type type; const char* name; } policies[] = { { LRU, "LRU" }, { CLOCK, "CLOCK" } };
+
+	// The figures are printed here, instead of the statistics dump at shutdown_db().
+	set_buffer_stats_dump(false);
+
+	printf("%-6s %8s %12s %14s\n", "policy", "threads", "ns/lookup", "lookups/s");
+	for (const auto& policy : policies) {
+		if (init_db(num_keys / 8, DEFAULT_NUM_OF_PARTITIONS, policy.type) != 0)
+			fail("init_db");
+		const int table_id = load_table(path, num_keys);
+
+		for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+			reset_buffer_stats();
+			const uint64_t start = now_ns();
+			run_threads(num_threads, [&](int id) {
+				Random random(id + 1);
+				for (long i = 0; i < num_ops; i++) {
+					const int64_t key = random.below(num_keys);
+					if (!find_checked(table_id, key))
+						fail("key %lld is missing", (long long)key);
+				}
+			});
+			const uint64_t elapsed = now_ns() - start;
+
+			buffer_stats stats;
+			get_buffer_stats(&stats);
+			if (stats.misses != 0)
+				fail("%llu misses, while the table fits in the pool", (unsigned long long)stats.misses);
+			printf("%-6s %8d %12.1f %14.0f\n", policy.name, num_threads,
+				(double)elapsed / num_ops, (double)num_ops * num_threads * 1e9 / elapsed);
+		}
+
+		close_table(table_id);
+		shutdown_db();
+		remove_table(path);
+	}
+	return 0;
+}
@@ -0,0 +1,112 @@
+#include "bench_util.h"
+#include "disk_manager.h"
+#include "page.h"
+
+#include <memory>
+
+/*
+ *  Random page reads at queue depths of 1 up to 128, with each I/O backend
+ *  The reads go to the disk manager directly, and the table is opened in DIRECT_IO mode
+ *  (where the file system supports it), so that they reach the device instead of the page cache.
+ *  SYNC_IO completes every read on submission, so only IO_URING keeps several of them in flight.
+ *  - keys: the number of keys in the table, which sets the size of the file
+ *  - reads: the number of reads per queue depth
+ *  - direct: 0 reads through the page cache
+ */
+
+/* The read pages are checked, and their slots are handed back for the next reads. */
+struct Reads
+{
+	std::unique_ptr<Page[]> pages;
+	std::vector<int> free_slots;
+	long num_done;
+};
+
+struct Slot
+{
+	Reads* reads;
+	int index;
+};
+
+static void completeRead(void* arg, int64_t result)
+{
+	Slot* slot = static_cast<Slot*>(arg);
+
+	if (result != PAGESIZE)
+		fail("a read returned %lld", (long long)result);
+	slot->reads->free_slots.push_back(slot->index);
+	++slot->reads->num_done;
+}
+
+int main(int argc, char** argv)
+{
+	const int64_t num_keys = arg(argc, argv, "keys", 200000);
+	const long num_reads = arg(argc, argv, "reads", 20000);
+	const table_mode mode = arg(argc, argv, "direct", 1) ? DIRECT_IO : BUFFERED;
+	const char* path = "bench_queue_depth.db";
+	const struct { io_backend backend; const char* name; } backends[] = {
+		{ SYNC_IO, "SYNC_IO" }, { IO_URING, "IO_URING" }
+	};
+
+	// The figures are printed here, instead of the statistics dump at shutdown_db().
+	set_buffer_stats_dump(false);
+
+	if (init_db(1024) != 0)
+		fail("init_db");
+	close_table(load_table(path, num_keys));
+	const int table_id = open_table(const_cast<char*>(path), 3, mode);
+	if (table_id <= 0)
+		fail("open_table(%s) = %d", path, table_id);
+
+	// The pages beyond the ones handed out are preallocated, and read as zeros without reaching the device.
+	Reads reads;
+	reads.pages.reset(new Page[IO_QUEUE_DEPTH]);
+	file_read_page(table_id, HEADER_PAGE_NUM, reads.pages[0]);
+	const int64_t num_pages = reads.pages[0].getNumOfPages();
+	if (num_pages < 2)
+		fail("the table has %lld pages", (long long)num_pages);
+
+	std::vector<Slot> slots(IO_QUEUE_DEPTH);
+	for (int i = 0; i < IO_QUEUE_DEPTH; i++)
+		slots[i] = { &reads, i };
+
+	printf("%-9s %6s %12s %12s\n", "backend", "depth", "reads/s", "us/read");
+	for (const auto& backend : backends) {
+		if (file_set_io_backend(backend.backend) != backend.backend) {
+			printf("%-9s (not available)\n", backend.name);
+			continue;
+		}
+
+		for (int depth = 1; depth <= IO_QUEUE_DEPTH; depth *= 2) {
+			Random random(depth);
+			reads.free_slots.clear();
+			for (int i = 0; i < depth; i++)
+				reads.free_slots.push_back(i);
+			reads.num_done = 0;
+
+			const uint64_t start = now_ns();
+			for (long i = 0; i < num_reads; i++) {
+				// Keep up to depth reads in flight.
+				if (reads.free_slots.empty())
+					file_wait_io(depth - 1);
+				const int index = reads.free_slots.back();
+				reads.free_slots.pop_back();
+				file_read_page_async(table_id, 1 + random.below(num_pages - 1), reads.pages[index],
+					completeRead, &slots[index]);
+			}
+			file_wait_io();
+			const uint64_t elapsed = now_ns() - start;
+
+			if (reads.num_done != num_reads)
+				fail("%ld of %ld reads completed", reads.num_done, num_reads);
+			printf("%-9s %6d %12.0f %12.2f\n", backend.name, depth,
+				num_reads * 1e9 / elapsed, (double)elapsed / num_reads / 1000);
+		}
+	}
+
+	file_set_io_backend(SYNC_IO);
+	close_table(table_id);
+	shutdown_db();
+	remove_table(path);
+	return 0;
+}
@@ -0,0 +1,83 @@
+#include "bench_util.h"
+
+#include <algorithm>
+#include <atomic>
+
+/*
+ *  Point lookups on a hot set while a scan sweeps the whole table, under each replacement policy
+ *  The table is much larger than the pool, and the hot set fits in it.
+ *  A scan-resistant policy keeps the hot pages resident while the scanned pages flow through.
+ *  - keys: the number of keys in the table
+ *  - hot: the number of hot keys, which are consecutive
+ *  - buffers: the size of the pool
+ *  - scans: the number of sweeps, which the lookups go on during
+ *  - threads: the number of lookup threads (one more thread scans)
+ */
+int main(int argc, char** argv)
+{
+	const int64_t num_keys = arg(argc, argv, "keys", 200000);
+	const int64_t num_hot = arg(argc, argv, "hot", 4000);
+	const int buf_num = arg(argc, argv, "buffers", 1024);
+	const long num_scans = arg(argc, argv, "scans", 2);
+	const int num_threads = arg(argc, argv, "threads", 2);
+	const int64_t chunk = 5000;
+	const char* path = "bench_scan_resistance.db";
+	const struct { policy_type type; const char* name; } policies[] = {
+		{ LRU, "LRU" }, { CLOCK, "CLOCK" }, { TWO_Q, "2Q" }
+	};
+
+	// The figures are printed here, instead of the statistics dump at shutdown_db().
+	set_buffer_stats_dump(false);
+
+	printf("%-6s %10s %14s\n", "policy", "hit %", "lookups/s");
+	for (const auto& policy : policies) {
+		if (init_db(buf_num, DEFAULT_NUM_OF_PARTITIONS, policy.type) != 0)
+			fail("init_db");
+		const int table_id = load_table(path, num_keys);
+		const int64_t hot_first = num_keys / 2;
+
+		reset_buffer_stats();
+		std::atomic<bool> scanning(true);
+		std::atomic<long> num_ops(0);
+		const uint64_t start = now_ns();
+		run_threads(num_threads + 1, [&](int id) {
+			if (id == num_threads) {
+				// Sweep the table in chunks.
+				std::vector<record_t> records(chunk);
+				for (long scan = 0; scan < num_scans; scan++) {
+					for (int64_t first = 0; first < num_keys; first += chunk) {
+						const int64_t last = std::min(first + chunk, num_keys) - 1;
+						const int num_found = find_range(table_id, first, last, records);
+						if (num_found != last - first + 1)
+							fail("scan of [%lld, %lld] found %d", (long long)first, (long long)last, num_found);
+						for (int i = 0; i < num_found; i++) {
+							if (records[i].key != first + i || records[i].values[0] != first + i)
+								fail("scan of [%lld, %lld] is wrong at %d", (long long)first, (long long)last, i);
+						}
+					}
+				}
+				scanning = false;
+				return;
+			}
+
+			Random random(id + 1);
+			long n = 0;
+			for (; scanning; n++) {
+				const int64_t key = hot_first + random.below(num_hot);
+				if (!find_checked(table_id, key))
+					fail("key %lld is missing", (long long)key);
+			}
+			num_ops += n;
+		});
+		const uint64_t elapsed = now_ns() - start;
+
+		buffer_stats stats;
+		get_buffer_stats(&stats);
+		printf("%-6s %10.2f %14.0f\n", policy.name, hit_ratio(stats), (double)num_ops * 1e9 / elapsed);
+
+		close_table(table_id);
+		shutdown_db();
+		remove_table(path);
+	}
+	return 0;
+}
@@ -8,14 +8,64 @@
 
 /*
  * Initialize buffer pool with given number and buffer manager.
+ * The buffer pool is split into the given number of partitions
+ * and managed by the given replacement policy.
+ * The page frames are backed by the given kind of memory pages.
+ * The batched reads and writes go through the given I/O backend. (IO_URING falls back to SYNC_IO)
  */
-int init_db(int buf_num);
+int init_db(int buf_num, int num_partitions = DEFAULT_NUM_OF_PARTITIONS, policy_type policy = LRU,
+			frame_backing backing = TRANSPARENT_HUGE_PAGES, io_backend io = SYNC_IO);
+
+/*
+ * Grow or shrink the buffer pool to the given number without shutting it down.
+ *  - Shrinking writes back and drops unpinned buffers only.
+ *  - If success, return 0. Otherwise, return non-zero value.
+ */
+int resize_db(int buf_num);
+
+/*
+ * Set the buffer quota of the table.
+ *  - The buffers of the table are not taken by the other tables while it holds no more than min_buf_num.
+ *  - Once it holds max_buf_num (0 for no limit), the table reuses its own buffers.
+ *  - The buffers of the tables in a lower priority class are replaced first.
+ *  - If success, return 0. Otherwise, return non-zero value.
+ */
+int set_buffer_quota(int table_id, int min_buf_num, int max_buf_num, buffer_priority priority = NORMAL_PRIORITY);
+
+/*
+ * Return the number of buffers which hold the pages of the table.
+ */
+int get_buffer_occupancy(int table_id);
+
+/*
+ * Turn the pointer swizzling of the child offsets on or off.
+ * While it is on, a descent follows the child pages in the buffer pool without looking them up.
+ */
+void set_pointer_swizzling(bool enable);
+
+/*
+ * Set the durability mode of the table, or of every table from now on if table_id is 0.
+ *  - FULL_SYNC: every page write is durable when it returns.
+ *  - CHECKPOINT_SYNC: the pages are made durable at close_table, shutdown_db and checkpoint only.
+ *  - NO_SYNC: the pages are left to the OS to write back.
+ *  - If success, return 0. Otherwise, return non-zero value.
+ */
+int set_durability(int table_id, durability_mode mode);
+
+/*
+ * Write back the buffers of the table (every open table if 0) and make them durable.
+ *  - If success, return 0. Otherwise, return non-zero value.
+ */
+int checkpoint(int table_id = 0);
 
 /*
  * Open existing data file using ‘pathname’ or create one if not existed.
+ * In MEMORY_MAPPED mode, find() and find_range() read the pages directly from the mapped file,
+ * while insert() and erase() go through the buffer pool and write the pages they modify to the file.
+ * In DIRECT_IO mode, the pages bypass the OS page cache, so the buffer pool is the only cache of the table.
  * If success, return table_id.
  */
-int open_table(char * pathname, int num_column);
+int open_table(char * pathname, int num_column, table_mode mode = BUFFERED);
 
 /*
  * Write the pages relating to this table to disk and close the table.
@@ -24,6 +74,21 @@ int open_table(char * pathname, int num_column);
  */
 int close_table(int table_id);
 
+/*
+ * Get the buffer pool statistics summed up over every thread since the last reset.
+ */
+void get_buffer_stats(buffer_stats* stats);
+
+/*
+ * Start the buffer pool statistics over from zero.
+ */
+void reset_buffer_stats(void);
+
+/*
+ * Turn the dump of the buffer pool statistics to stderr at shutdown_db() on or off. (on by default)
+ */
+void set_buffer_stats_dump(bool enable);
+
 /*
  * Destroy buffer manager.
  *  - Flush all data from buffer and destroy allocated buffer.
@@ -1,119 +1,526 @@
-﻿#ifndef __BUFFER_MANAGER_H__
-#define __BUFFER_MANAGER_H__
-
-#include "page.h"
-
-class BufferBlock
-{
-	friend class BufferManager;
-private:
-	/* • Physical frame: containing up to date contents of target page. */
-	Page frame;
-	/* • Table id: the unique id of table (per file) */
-	int table_id;
-	/* • Page number: the target page number within a file. */
-	pagenum_t pgnum;
-	/* • Is dirty: whether this buffer block is dirty or not. */
-	bool dirty;
-	/* • Is pinned: whether this buffer is accessed right now. */
-	int pin_cnt;
-	/* • LRU list next (prev) : buffer blocks are managed by LRU list. */
-	BufferBlock *next, *prev;
-	/* • Lock Object (Local) : each buffer block has its own lock */
-	latch lock;
-	/* • Other information can be added with your own buffer manager design. */
-
-	BufferBlock(int table_id = 0, pagenum_t pgnum = 0);
-public:
-	BufferBlock(const BufferBlock&) = delete;
-	int getTableID()
-	{
-		return table_id;
-	};
-	pagenum_t getPageNum()
-	{
-		return pgnum;
-	};
-	bool isDirty()
-	{
-		return dirty;
-	};
-	int countPins()
-	{
-		return pin_cnt;
-	};
-	Page& getPage();
-};
-
-class BufferManager
-{
-private:
-	static bool initialized;
-	static BufferBlock* pool;
-	static latch global_lock;
-
-public:
-	/*
-	 *  Initialize the buffer pool with the given number.
-	 */
-	static int init(int buf_num);
-
-private:
-	BufferManager() = delete;
-	static void putAtFront(BufferBlock* p);
-
-public:
-
-	/*
-	 *  Get the buffer control block from the buffer pool.
-	 */
-	static BufferBlock* get_frame(int table_id, pagenum_t pagenum);
-
-	/*
-	 *  Put the buffer block back to the buffer pool.
-	 */
-	static void put_frame(BufferBlock* src);
-
-	/*
-	 *  Get the page and set whether this block gets dirty.
-	 */
-	static Page* get_page(BufferBlock* frame, bool dirty);
-
-	/*
-	 *  Request the allocatioin of a page to the disk manager
-	 *  and return the offset of the new page.
-	 */
-	static pagenum_t buf_alloc_page(int table_id);
-
-	/*
-	 *  Request the unused page to be free to the disk manager.
-	 */
-	static void buf_free_page(int table_id, pagenum_t page_to_be_free);
-
-	/*
-	 *  Flush the buffers of the given table and clear them.
-	 */
-	static void close_table(int table_id);
-
-	/*
-	 *  Flush the specific buffer and clear it.
-	 */
-	static void close_frame(BufferBlock* frame);
-
-	/*
-	 *  Flush the buffers of the given table.
-	 */
-	static void flush_table(int table_id);
-
-	/*
-	 *  Flush the specific buffer.
-	 */
-	static void flush_frame(BufferBlock* frame);
-
-	/*
-	 *  Flush all buffers in the buffer pool and free the pool.
-	 */
-	static void shutdown(void);
-};
-
+﻿#ifndef __BUFFER_MANAGER_H__
+#define __BUFFER_MANAGER_H__
+
+#include "page.h"
+#include "page_table.h"
+#include "replacement_policy.h"
+
+#include <atomic>
+#include <deque>
+#include <ostream>
+#include <vector>
+
+class BufferPartition;
+
+class BufferBlock
+{
+	friend class BufferManager;
+	friend class BufferPartition;
+	friend class ReplacementPolicy;
+	friend class LRUPolicy;
+	friend class ClockPolicy;
+	friend class TwoQPolicy;
+private:
+	/* • Physical frame: containing up to date contents of target page. (a slot of the frame arena) */
+	Page* frame;
+	/* • Table id: the unique id of table (per file) */
+	int table_id;
+	/* • Page number: the target page number within a file. */
+	pagenum_t pgnum;
+	/* • Is dirty: whether this buffer block is dirty or not. */
+	std::atomic<bool> dirty;
+	/* • Is pinned: whether this buffer is accessed right now. (negative while the page is being replaced) */
+	std::atomic<int> pin_cnt;
+	/* • LRU list next (prev) : buffer blocks are managed by LRU list. */
+	BufferBlock *next, *prev;
+	/* • Reference bit : used by the CLOCK replacement policy. */
+	std::atomic<bool> referenced;
+	/* • Queue : which queue of the 2Q replacement policy holds this block. */
+	int queue;
+	/* • Lock Object (Local) : each buffer block has its own shared/exclusive latch, held while the block is pinned by a user. */
+	rw_latch lock;
+	/* • Version : bumped whenever the page is modified or replaced, odd while it is going on. (for optimistic reads) */
+	std::atomic<uint64_t> version;
+	/* • Partition : the buffer partition which owns this block. */
+	BufferPartition* owner;
+	/* • Retired : whether the block has been taken out of the pool by a shrink. */
+	bool retired;
+	/* • Swizzle tag : the frame chunk and slot of this block in a swizzled child offset. (0 if it has none) */
+	uint64_t swip;
+	/* • Index page : whether the block holds an internal page or a header page, which belongs to the index region. */
+	std::atomic<bool> index_page;
+	/* • Other information can be added with your own buffer manager design. */
+
+	BufferBlock(int table_id = 0, pagenum_t pgnum = 0);
+public:
+	BufferBlock(const BufferBlock&) = delete;
+	int getTableID()
+	{
+		return table_id;
+	};
+	pagenum_t getPageNum()
+	{
+		return pgnum;
+	};
+	bool isDirty()
+	{
+		return dirty;
+	};
+	int countPins()
+	{
+		return pin_cnt;
+	};
+	uint64_t getVersion()
+	{
+		return version.load(std::memory_order_acquire);
+	};
+	Page& getPage();
+};
+
+/*
+ *  A dirty block pinned for a write-back, with the page which it held then.
+ */
+struct DirtyPage
+{
+	BufferBlock* block;
+	int table_id;
+	pagenum_t pgnum;
+};
+
+/*
+ *  A child entry of an internal page which a descent has followed, to be swizzled.
+ */
+struct ChildEntry
+{
+	BufferBlock* parent;
+	pagenum_t parent_pgnum;
+	/* The version of the parent when the entry was read */
+	uint64_t version;
+	key_idx_t index;
+	/* The entry as it was read, which may be swizzled */
+	offset_t entry;
+};
+
+/*
+ *  A buffer partition is an independent piece of the buffer pool.
+ *  Each (table id, page number) is hashed into exactly one partition,
+ *  which has its own page directory, replacement policy and latch.
+ */
+class BufferPartition
+{
+	friend class BufferManager;
+private:
+	/* Buffer blocks owned by this partition */
+	std::vector<BufferBlock*> blocks;
+	/* Buffer blocks taken out by a shrink, which are used again first by a grow. */
+	std::vector<BufferBlock*> retired;
+	/* Replacement policy: decides which block is evicted. */
+	ReplacementPolicy* policy;
+	/* Page directory: (table id, page number) -> resident buffer block, which is looked up without the latch */
+	PageTable directory;
+	/* Partition latch: protects the updates of the directory and the replacement policy of this partition. */
+	latch lock;
+	/* Signaled when a block is unpinned while a request is waiting for one. */
+	pthread_cond_t unpinned;
+	/* The number of requests waiting for a block to be unpinned */
+	std::atomic<int> num_pin_waiters;
+	/* The number of blocks in the index region */
+	std::atomic<int> num_index_frames;
+
+	BufferPartition();
+	~BufferPartition();
+
+	int init(BufferBlock* blocks, int buf_num, policy_type type);
+
+	/* Add the given buffer blocks to this partition. */
+	void grow(BufferBlock* first, int buf_num);
+	/* Bring back up to n retired blocks and return the number of them. */
+	int revive(size_t n);
+	/* Retire up to n unpinned blocks and return the number of them. */
+	int shrink(size_t n);
+
+	/*
+	 *  If every block is pinned, wait up to PIN_WAIT_TIMEOUT_MS for one to be unpinned.
+	 *  If may_write_back is not set, a dirty block is never replaced, and it never waits.
+	 *  If unread is given, a missed page is left to the caller: the block is returned latched in EXCLUSIVE mode
+	 *  with *unread set, and the caller reads the page and calls finishRead().
+	 */
+	BufferBlock* get_frame(int table_id, pagenum_t pagenum, bool may_write_back = true, bool* unread = NULL);
+	/* Publish the page read into the block. (by the thread which got it from get_frame()) */
+	void finishRead(BufferBlock* block);
+	void put_frame(BufferBlock* src);
+	/* Unpin the block, and wake up a request waiting for it, if any. (without the partition latch) */
+	void unpin(BufferBlock* block);
+
+	/* Pin the block found without the latch, if it still holds the page and is not being replaced. */
+	bool tryPin(BufferBlock* block, int table_id, pagenum_t pagenum);
+	/*
+	 *  Claim an unpinned block to replace or reset its page, so that no one pins it in the meantime.
+	 *  Release it with the pins of the caller, and of the requests which found it under the partition latch in the meantime.
+	 */
+	static bool claim(BufferBlock* block);
+	static void release(BufferBlock* block, int pins);
+	void close_table(int table_id);
+	void close_frame(BufferBlock* frame);
+
+	/* Pin the dirty blocks of the table (every table if 0) and append them to dest. */
+	void collectDirty(int table_id, std::vector<DirtyPage>& dest);
+	/* Pin the block if it still holds the dirty page, and return whether it does. */
+	bool pinDirty(const DirtyPage& page);
+
+	/* Append the page numbers of the table (every table if 0) held by this partition, the hottest first. */
+	void collectResident(int table_id, std::vector<DirtyPage>& dest);
+
+	/* Write back up to n dirty, unpinned blocks from the cold end and return the number of them. */
+	int clean(size_t n);
+
+	/* Choose a block to be replaced for the given table, honoring the buffer quotas and sparing the index region first. */
+	BufferBlock* chooseVictim(int table_id, bool may_write_back);
+
+	/* Move the block into or out of the index region. */
+	void classify(BufferBlock* block, bool index_page);
+	/* Choose a block accepted by the filter, going up from the lowest priority class. */
+	BufferBlock* filteredVictim(VictimFilter& filter, bool clean_only);
+
+	/* Drop the frame from the directory and reset it. (The partition latch must be held.) */
+	void resetFrame(BufferBlock* frame);
+public:
+	BufferPartition(const BufferPartition&) = delete;
+};
+
+class BufferManager
+{
+	friend class BufferPartition;
+	friend class ReplacementPolicy;
+private:
+	static bool initialized;
+	static BufferPartition* partitions;
+	static int num_partitions;
+
+	/*
+	 *  Frame chunk: every page frame is a PAGESIZE-aligned slot of a contiguous region (arena),
+	 *  and its buffer block lives in a compact array apart from the pages (descriptors).
+	 *  The pool starts with one chunk and a grow adds another.
+	 *  Chunks are never freed until shutdown, so a buffer block never goes away under a reader.
+	 */
+	struct FrameChunk
+	{
+		byte* arena;
+		size_t arena_size;
+		BufferBlock* descriptors;
+	};
+	static std::vector<FrameChunk> chunks;
+	static frame_backing backing;
+	/* Serializes the resizes of the pool. */
+	static latch resize_lock;
+
+	/*
+	 *  Buffer quota of a table
+	 *  - min_frames: the frames of the table are not taken by the other tables while it holds no more than this.
+	 *  - max_frames: the table replaces its own frames once it holds this many. (0 for no limit)
+	 *  - priority: the frames of a lower priority class are replaced first.
+	 *  - occupancy: the number of frames which hold the pages of the table.
+	 */
+	struct TableQuota
+	{
+		int min_frames;
+		int max_frames;
+		buffer_priority priority;
+		std::atomic<int> occupancy;
+
+		TableQuota()
+			:min_frames(0), max_frames(0), priority(NORMAL_PRIORITY), occupancy(0)
+		{
+
+		};
+	};
+	/* Indexed by the table id */
+	static TableQuota quotas[DEFAULT_SIZE_OF_TABLES + 1];
+	/* Whether any table has got a quota, so that the victims need to be filtered. */
+	static std::atomic<bool> quotas_enabled;
+	/* Bumped whenever the pool is initialized, so that the frame hints of the old pool are not used. */
+	static uint64_t generation;
+
+	/* Whether the descents swizzle the child offsets which they follow */
+	static std::atomic<bool> swizzling;
+	/* The frame descriptors of the chunks, indexed by the chunk number in a swizzled child offset */
+	static BufferBlock* swizzle_chunks[MAX_SWIZZLE_CHUNKS];
+
+	/* Page cleaner: writes back cold dirty blocks in the background. */
+	static thread cleaner;
+	static bool cleaner_running;
+	static latch cleaner_lock;
+	static pthread_cond_t cleaner_cond;
+	/* The number of dirty blocks and the mark which wakes up the page cleaner */
+	static std::atomic<int> num_dirty;
+	static int dirty_high_water;
+	static int dirty_high_water_percent;
+	static int num_blocks;
+	/* The number of write-backs of each table which have made their pages clean but are not written yet */
+	static std::atomic<int> writes_in_flight[DEFAULT_SIZE_OF_TABLES + 1];
+	/* The blocks dirtied by the update of each table in progress (see track_updates()) */
+	static std::atomic<bool> tracking_updates[DEFAULT_SIZE_OF_TABLES + 1];
+	static std::vector<DirtyPage> updated_pages[DEFAULT_SIZE_OF_TABLES + 1];
+
+	/* Prefetcher: reads the leaf pages ahead of a scan in the background. */
+	struct PrefetchRequest
+	{
+		int table_id;
+		pagenum_t pgnum;
+		int depth;
+	};
+	static thread prefetcher;
+	static bool prefetcher_running;
+	static latch prefetch_lock;
+	static pthread_cond_t prefetch_cond;
+	static std::deque<PrefetchRequest> prefetch_queue;
+	/* The table which the prefetcher is reading right now */
+	static int prefetching_table_id;
+	static pthread_cond_t prefetch_done_cond;
+
+	/* A run of consecutive dirty pages being written, whose blocks are latched in SHARED mode until it completes */
+	struct WriteRun
+	{
+		std::vector<BufferBlock*> blocks;
+		std::vector<const Page*> frames;
+		/* The unswizzled copies of the node pages */
+		std::deque<Page> copies;
+	};
+
+public:
+	/*
+	 *  Initialize the buffer pool with the given number
+	 *  split into the given number of partitions,
+	 *  which are managed by the given replacement policy.
+	 *  The page frames are backed by the given kind of memory pages.
+	 */
+	static int init(int buf_num, int num_partitions = DEFAULT_NUM_OF_PARTITIONS, policy_type policy = LRU,
+					frame_backing backing = TRANSPARENT_HUGE_PAGES);
+
+	/* Make a directory key from the table id and the page number. */
+	static uint64_t makeKey(int table_id, pagenum_t pgnum)
+	{
+		return (static_cast<uint64_t>(table_id) << 56) | pgnum;
+	};
+
+private:
+	BufferManager() = delete;
+
+	/* Count a frame in (delta = 1) or out (delta = -1) of the occupancy of the table. */
+	static void countFrame(int table_id, int delta);
+
+	/* Whether the block may be replaced for the table of the filter. */
+	static bool honorsQuota(const BufferBlock* block, const VictimFilter& filter);
+
+	/* Find the partition which the given page belongs to. */
+	static BufferPartition& partitionOf(int table_id, pagenum_t pgnum);
+
+	/* Return the frame as it is written to the disk, which may be copied into the given page. */
+	static const Page* diskImage(const BufferBlock* frame, Page& copy);
+
+	/* Write back the frame if it is dirty. (The frame must be latched, or unpinned under the partition latch.) */
+	static void writeBack(BufferBlock* frame);
+
+	/*
+	 *  Write back the pinned dirty pages in the order of the page numbers,
+	 *  coalescing the consecutive ones into a vectored write, and unpin them.
+	 *  The writes of the runs are in flight at once. Each table gets a single durability barrier.
+	 */
+	static void writeBackBatch(std::vector<DirtyPage>& pages);
+
+	/* The completion of a page read for the block of the argument, which is published and unpinned. */
+	static void completeRead(void* arg, int64_t result);
+	/* The completion of the write of a run, whose blocks are unlatched. */
+	static void completeWrite(void* arg, int64_t result);
+
+	/* Save the resident pages of the table (every open table if 0) as its working set. */
+	static void saveWorkingSet(int table_id);
+
+	/* Map an aligned, contiguous region for the page frames. */
+	static byte* allocateArena(size_t size, frame_backing backing);
+
+	/* Allocate a new frame chunk and return its buffer blocks. */
+	static BufferBlock* allocateFrames(int buf_num);
+	/* Release every frame chunk. */
+	static void releaseFrames(void);
+
+	/* Main loop of the page cleaner thread */
+	static void* runCleaner(void* arg);
+
+	/* Wake up the page cleaner. */
+	static void wakeCleaner();
+
+	/* Main loop of the prefetcher thread */
+	static void* runPrefetcher(void* arg);
+
+	/* Read the leaf chain from the given page into the buffer pool. */
+	static void readAhead(const PrefetchRequest& request);
+
+public:
+
+	/*
+	 *  Get the buffer control block from the buffer pool,
+	 *  latched in the given mode. (SHARED for reading, EXCLUSIVE for writing)
+	 *  If every block is pinned, wait up to PIN_WAIT_TIMEOUT_MS for one to be unpinned,
+	 *  and return NULL if none is.
+	 */
+	static BufferBlock* get_frame(int table_id, pagenum_t pagenum, lock_mode mode);
+
+	/*
+	 *  Release the latch and put the buffer block back to the buffer pool.
+	 */
+	static void put_frame(BufferBlock* src);
+
+	/*
+	 *  Get the buffer control block for an optimistic read, neither pinned nor latched,
+	 *  and the version of the page to validate the read with.
+	 *  Return NULL if the page is not in the buffer pool or is being modified.
+	 */
+	static BufferBlock* get_frame_optimistic(int table_id, pagenum_t pagenum, uint64_t& version);
+
+	/*
+	 *  Check that the page has not been modified or replaced since get_frame_optimistic().
+	 *  Whatever was read from the page is valid only if it returns true.
+	 */
+	static bool validate(BufferBlock* block, uint64_t version);
+
+	/*
+	 *  Get the buffer control block which a swizzled child offset points at, like get_frame_optimistic(),
+	 *  without looking up the page directory.
+	 *  Return NULL if the block doesn't hold the page any more or is being modified.
+	 */
+	static BufferBlock* get_frame_swizzled(int table_id, offset_t entry, uint64_t& version);
+
+	/*
+	 *  Point the child entry at the block which holds the child page, if swizzling is on.
+	 *  It is skipped if the parent is latched in EXCLUSIVE mode or has been modified since the entry was read.
+	 *  The caller must not hold the latch of the parent.
+	 */
+	static void swizzle(int table_id, const ChildEntry& from, BufferBlock* child, pagenum_t pgnum);
+
+	/*
+	 *  Turn the pointer swizzling on or off.
+	 *  The child offsets swizzled so far are still followed until their pages are written or replaced.
+	 */
+	static void set_swizzling(bool enable);
+
+	/*
+	 *  Hint that the leaf chain starting from the given page is going to be scanned.
+	 *  Up to depth pages of the chain are read into the buffer pool in the background.
+	 */
+	static void prefetch(int table_id, pagenum_t pagenum, int depth = DEFAULT_PREFETCH_DEPTH);
+
+	/*
+	 *  Get the page and set whether this block gets dirty.
+	 *  The block must be latched in EXCLUSIVE mode to make it dirty.
+	 */
+	static Page* get_page(BufferBlock* frame, bool dirty);
+
+	/*
+	 *  Request the allocatioin of a page to the disk manager
+	 *  and return the offset of the new page, placed near the given page if it can be.
+	 */
+	static pagenum_t buf_alloc_page(int table_id, pagenum_t near = HEADER_PAGE_NUM);
+
+	/*
+	 *  Request the unused page to be free to the disk manager.
+	 */
+	static void buf_free_page(int table_id, pagenum_t page_to_be_free);
+
+	/*
+	 *  Read the working set saved when the table was closed last time
+	 *  into the buffer pool in the order of the page numbers.
+	 *  It stops as soon as a partition has no clean block to spare.
+	 */
+	static void warm_up(int table_id);
+
+	/*
+	 *  Flush the buffers of the given table and clear them.
+	 *  The resident pages are saved as the working set of the table.
+	 */
+	static void close_table(int table_id);
+
+	/*
+	 *  Flush the specific buffer and clear it.
+	 *  The caller must hold the block in EXCLUSIVE mode.
+	 */
+	static void close_frame(BufferBlock* frame);
+
+	/*
+	 *  Flush the buffers of the given table.
+	 *  The write-backs of the table started by others (the page cleaner, an eviction) are waited for as well.
+	 */
+	static void flush_table(int table_id);
+
+	/*
+	 *  Record the blocks of the table which get dirty from now on.
+	 *  The caller must serialize the updates of the table until flush_updates().
+	 */
+	static void track_updates(int table_id);
+
+	/*
+	 *  Flush the buffers dirtied since track_updates() only, and stop recording them.
+	 *  The write-backs of the table started by others are waited for as well, as in flush_table().
+	 */
+	static void flush_updates(int table_id);
+
+	/*
+	 *  Flush the specific buffer.
+	 *  The caller must not hold the latch of the block.
+	 */
+	static void flush_frame(BufferBlock* frame);
+
+	/*
+	 *  Grow or shrink the buffer pool to the given number of blocks online.
+	 *  - Shrinking writes back and retires unpinned blocks only.
+	 *  - Each partition keeps at least MIN_SIZE_OF_PARTITION blocks.
+	 *  - If the pool reaches the given size, return 0.
+	 *  - Otherwise, return non-zero value.
+	 */
+	static int resize(int buf_num);
+
+	/*
+	 *  Set the buffer quota of the table.
+	 *  - The frames of the table are not taken by the other tables while it holds no more than min_frames.
+	 *  - Once it holds max_frames (0 for no limit), the table replaces its own frames.
+	 *  - The frames of a lower priority class are replaced first.
+	 *  The quotas are honored as long as the partition has such a frame to replace.
+	 *  - If success, return 0.
+	 *  - Otherwise, return non-zero value.
+	 */
+	static int set_table_quota(int table_id, int min_frames, int max_frames, buffer_priority priority = NORMAL_PRIORITY);
+
+	/*
+	 *  Return the number of frames which hold the pages of the table.
+	 */
+	static int get_table_occupancy(int table_id);
+
+	/*
+	 *  Sum up the statistics of every thread since the last reset.
+	 */
+	static void get_stats(buffer_stats& stats);
+
+	/*
+	 *  Start the statistics over from zero.
+	 */
+	static void reset_stats(void);
+
+	/*
+	 *  Print the statistics in a human-readable form.
+	 */
+	static void print_stats(std::ostream& os);
+
+	/*
+	 *  Set the percentage of dirty blocks in the buffer pool
+	 *  above which the page cleaner works without a pause.
+	 */
+	static void set_dirty_high_water(int percent);
+
+	/*
+	 *  Flush all buffers in the buffer pool and free the pool.
+	 *  The resident pages are saved as the working sets of the tables.
+	 */
+	static void shutdown(void);
+};
+
 #endif
\ No newline at end of file
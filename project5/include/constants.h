@@ -1,54 +1,110 @@
-// CONSTANTS
-#ifndef __CONSTANTS_H__
-#define __CONSTANTS_H__
-
-// For debugging and testing the application
-#define TESTMODE 0
-
-// ORDER of disk-based B+ trees
-constexpr auto DEFAULT_INTERNAL_ORDER = 249;
-constexpr auto DEFAULT_LEAF_ORDER = 32;
-
-// Maximums
-constexpr auto MAX_NUM_COLUMNS = 16;
-
-// Page size
-constexpr auto PAGESIZE = 4096;
-
-// Default sizes
-constexpr auto DEFAULT_SIZE_OF_FREE_PAGES = 10;
-constexpr auto DEFAULT_SIZE_OF_TABLES = 10;
-constexpr auto DEFAULT_KEY_SIZE = 8;
-constexpr auto DEFAULT_VALUE_SIZE = 120;
-constexpr auto DEFAULT_RECORD_SIZE = (DEFAULT_KEY_SIZE + DEFAULT_VALUE_SIZE);
-
-/* Error Code */
-constexpr auto SUCCESS = 0;
-constexpr auto INVALID_OFFSET = -1;
-constexpr auto INVALID_INDEX = -2;
-constexpr auto INVALID_KEY = -3;
-constexpr auto INVALID_PAGE = -4;
-constexpr auto INVALID_FD = -5;
-constexpr auto INVALID_FILENAME = -6;
-constexpr auto INVALID_TID = -7;
-constexpr auto FULL_FD = -8;
-constexpr auto READ_ERROR = -9;
-constexpr auto WRITE_ERROR = -10;
-constexpr auto SEEK_ERROR = -11;
-
-/* Exception Code */
-constexpr auto KEY_EXIST = -100;
-constexpr auto KEY_NOT_FOUND = -101;
-
-/* Offset */
-constexpr auto HEADER_PAGE_NUM = 0ull;
-constexpr auto HEADER_PAGE_OFFSET = 0ull;
-
-#include <stdint.h>
-#include <stdbool.h>
-#include <sys/types.h>
-
-#define OFFSET(pagenum) ((pagenum)* PAGESIZE)
-#define PGNUM(pageoffset) ((pageoffset) / PAGESIZE)
-
+// CONSTANTS
+#ifndef __CONSTANTS_H__
+#define __CONSTANTS_H__
+
+// For debugging and testing the application
+#define TESTMODE 0
+
+// ORDER of disk-based B+ trees
+constexpr auto DEFAULT_INTERNAL_ORDER = 249;
+constexpr auto DEFAULT_LEAF_ORDER = 32;
+
+// Maximums
+constexpr auto MAX_NUM_COLUMNS = 16;
+
+// Page size
+constexpr auto PAGESIZE = 4096;
+
+// Default sizes
+constexpr auto DEFAULT_SIZE_OF_FREE_PAGES = 10; // the first extent the file grows by
+constexpr auto MAX_SIZE_OF_FREE_PAGES = 4096; // an extent doubles up to this (16MB)
+
+// Free space maps
+// A map page keeps the 128-byte header of a node page, and a bit per page in the rest.
+constexpr auto PAGES_PER_FREE_MAP = (PAGESIZE - 128) * 8;
+constexpr auto MAX_FREE_MAP_PAGES = 500; // listed in the header page, covering 60GB of a table
+constexpr auto DEFAULT_SIZE_OF_TABLES = 10;
+constexpr auto DEFAULT_KEY_SIZE = 8;
+constexpr auto DEFAULT_VALUE_SIZE = 120;
+constexpr auto DEFAULT_RECORD_SIZE = (DEFAULT_KEY_SIZE + DEFAULT_VALUE_SIZE);
+constexpr auto DEFAULT_NUM_OF_PARTITIONS = 8;
+
+// Minimum number of buffer blocks per buffer partition
+constexpr auto MIN_SIZE_OF_PARTITION = 16;
+
+// Maximum time to wait for a buffer block to be unpinned when every block is pinned
+constexpr auto PIN_WAIT_TIMEOUT_MS = 1000;
+// Interval at which closing a table looks again for its blocks which were pinned, even if no unpin wakes it up
+constexpr auto CLOSE_PIN_POLL_MS = 1;
+
+// Index region: the index pages (internal and header pages) are spared
+// while they take up no more than this percentage of a partition.
+constexpr auto INDEX_REGION_PERCENT = 20;
+
+// Page cleaner
+constexpr auto DEFAULT_DIRTY_HIGH_WATER = 10; // percentage of dirty blocks
+constexpr auto CLEANER_INTERVAL_MS = 100;
+
+// Read-ahead
+constexpr auto DEFAULT_PREFETCH_DEPTH = 8;
+constexpr auto MAX_PREFETCH_DEPTH = 64;
+constexpr auto MAX_PREFETCH_REQUESTS = 64;
+constexpr auto SEQUENTIAL_SCAN_THRESHOLD = 2; // the number of consecutive sibling leaves
+
+// Write-back
+constexpr auto MAX_WRITE_BATCH = 256; // pages per vectored write
+
+// Asynchronous I/O
+constexpr auto IO_QUEUE_DEPTH = 128; // requests in flight per thread
+
+// Memory-mapped tables
+constexpr auto MAX_MAPPED_TABLE_SIZE = 1ull << 36; // address space reserved per table
+constexpr auto MAX_MAPPED_TREE_HEIGHT = 16; // a longer path is taken for a torn read
+
+// Working set (warm restart)
+constexpr auto WARM_FILE_SUFFIX = ".warm"; // saved next to the data file
+constexpr auto WARM_FILE_MAGIC = 0x4D524157ull; // "WARM"
+
+// Optimistic reads
+constexpr auto NUM_OF_FRAME_HINTS = 64; // per thread
+constexpr auto OPTIMISTIC_RESTART_LIMIT = 4; // restarts before falling back to the latches
+
+// Pointer swizzling
+// A swizzled child offset: tag (1 bit) | frame chunk (6 bits) | frame slot (21 bits) | page number (36 bits)
+constexpr auto SWIZZLED_BIT = 1ull << 63;
+constexpr auto SWIZZLE_CHUNK_SHIFT = 57;
+constexpr auto SWIZZLE_SLOT_SHIFT = 36;
+constexpr auto MAX_SWIZZLE_CHUNKS = 64;
+constexpr auto MAX_SWIZZLE_SLOTS = 1 << 21;
+constexpr auto SWIZZLE_PGNUM_MASK = (1ull << SWIZZLE_SLOT_SHIFT) - 1;
+
+/* Error Code */
+constexpr auto SUCCESS = 0;
+constexpr auto INVALID_OFFSET = -1;
+constexpr auto INVALID_INDEX = -2;
+constexpr auto INVALID_KEY = -3;
+constexpr auto INVALID_PAGE = -4;
+constexpr auto INVALID_FD = -5;
+constexpr auto INVALID_FILENAME = -6;
+constexpr auto INVALID_TID = -7;
+constexpr auto FULL_FD = -8;
+constexpr auto READ_ERROR = -9;
+constexpr auto WRITE_ERROR = -10;
+constexpr auto SEEK_ERROR = -11;
+
+/* Exception Code */
+constexpr auto KEY_EXIST = -100;
+constexpr auto KEY_NOT_FOUND = -101;
+
+/* Offset */
+constexpr auto HEADER_PAGE_NUM = 0ull;
+constexpr auto HEADER_PAGE_OFFSET = 0ull;
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#define OFFSET(pagenum) ((pagenum)* PAGESIZE)
+#define PGNUM(pageoffset) ((pageoffset) / PAGESIZE)
+
 #endif
\ No newline at end of file
@@ -1,43 +1,136 @@
-#ifndef __DISK_MANAGER_H__
-#define __DISK_MANAGER_H__
-
-#include "types.h"
-
-/*
- * Open existing data file using ‘pathname’ or create one if not existed.
- * If success, return table_id.
- */
-int file_open_table(char * pathname, int num_column);
-
-/*
- * Write the pages relating to this table to disk and close the table.
- *  - Write all pages of this table from buffer to disk and discard the table id.
- *  - If success, return 0. Otherwise, return non-zero value.
- */
-int file_close_table(int table_id);
-
-/*
- *  Read an on-disk page into the in-memory page structure(dest)
- */
-void file_read_page(int table_id, pagenum_t pagenum, Page& dest);
-
-/*
- *  Write an in-memory page(src) to the on-disk page
- */
-void file_write_page(int table_id, pagenum_t pagenum, const Page& src);
-
-/*
- *  Free an on-disk page to the free page list
- */
-void file_free_page(int table_id, pagenum_t pagenum);
-
-/*
- *  Allocate an on-disk page from the free page list
- */
-pagenum_t file_alloc_page(int table_id);
-
-/*  Return the number of columns of the table specified by the given table_id.
- */
-int getNumOfCols(int table_id) noexcept;
-
+#ifndef __DISK_MANAGER_H__
+#define __DISK_MANAGER_H__
+
+#include "types.h"
+
+#include <vector>
+
+/*
+ * Open existing data file using ‘pathname’ or create one if not existed.
+ * A table opened in MEMORY_MAPPED mode is mapped for the readers as well. (see file_map_begin())
+ * A table opened in DIRECT_IO mode is read and written with O_DIRECT, if the file system supports it.
+ * If success, return table_id.
+ */
+int file_open_table(char * pathname, int num_column, table_mode mode = BUFFERED);
+
+/*
+ * Write the pages relating to this table to disk and close the table.
+ *  - Write all pages of this table from buffer to disk and discard the table id.
+ *  - If success, return 0. Otherwise, return non-zero value.
+ */
+int file_close_table(int table_id);
+
+/*
+ *  Read an on-disk page into the in-memory page structure(dest)
+ *  The reads and writes of the pages take no latch, so several of them may be in flight at once.
+ */
+void file_read_page(int table_id, pagenum_t pagenum, Page& dest);
+
+/*
+ *  Write an in-memory page(src) to the on-disk page
+ */
+void file_write_page(int table_id, pagenum_t pagenum, const Page& src);
+
+/*
+ *  Write the in-memory pages(src) to the consecutive on-disk pages from pagenum
+ *  with a single vectored write. (durable on return only in FULL_SYNC mode)
+ */
+void file_write_pages(int table_id, pagenum_t pagenum, const Page* const* src, int count);
+
+/*
+ *  Read an on-disk page into dest asynchronously, and call done(arg, the number of bytes read or -errno).
+ *  - The callback is called by this thread, from a later file_wait_io(),
+ *    or before the return with the SYNC_IO backend.
+ *  - dest must be left alone until then.
+ */
+void file_read_page_async(int table_id, pagenum_t pagenum, Page& dest, io_callback done, void* arg);
+
+/*
+ *  Write the in-memory pages(src) to the consecutive on-disk pages from pagenum asynchronously,
+ *  and call done(arg, the number of bytes written or -errno) like file_read_page_async().
+ *  (not durable until file_sync(), which the caller issues once after a batch of writes, in every mode)
+ */
+void file_write_pages_async(int table_id, pagenum_t pagenum, const Page* const* src, int count, io_callback done, void* arg);
+
+/*
+ *  Wait until no more than max_in_flight asynchronous requests of this thread are in flight,
+ *  calling the callbacks of the completed ones.
+ */
+void file_wait_io(int max_in_flight = 0);
+
+/*
+ *  Select the backend of the asynchronous I/O.
+ *  - IO_URING falls back to SYNC_IO if io_uring is not available.
+ *  - Return the backend in effect.
+ */
+io_backend file_set_io_backend(io_backend backend);
+
+/*
+ *  Make the pages written to the table durable, unless it is in NO_SYNC mode.
+ */
+void file_sync(int table_id);
+
+/*
+ *  Write back the buffers of the table (every open table if 0) and make them durable.
+ *  - If success, return 0. Otherwise, return non-zero value.
+ */
+int file_checkpoint(int table_id);
+
+/*
+ *  Set the durability mode of the table, or of every table from now on if table_id is 0.
+ *  - FULL_SYNC: every page write is durable when it returns.
+ *  - CHECKPOINT_SYNC: the pages are made durable at a close, a shutdown and a checkpoint only.
+ *  - NO_SYNC: the pages are left to the OS to write back.
+ *  - If success, return 0. Otherwise, return non-zero value.
+ */
+int file_set_durability(int table_id, durability_mode mode);
+
+/*
+ *  Read a mapped table optimistically, without the buffer pool:
+ *  - file_map_begin() returns false if the table is not mapped or is being updated,
+ *    and the pages must be read through the buffer pool then.
+ *  - file_mapped_page() returns the page in the mapping, or nullptr beyond it.
+ *    The page may be changed by an update while it is read, so its contents must be checked before use.
+ *  - What has been read is valid only if file_map_validate() returns true.
+ */
+bool file_map_begin(int table_id, uint64_t& version);
+const Page* file_mapped_page(int table_id, pagenum_t pagenum);
+bool file_map_validate(int table_id, uint64_t version);
+
+/*
+ *  Bracket an update of a mapped table. (nothing for the other tables)
+ *  - The updates are serialized, and the readers of the mapping go to the buffer pool in the meantime.
+ *  - At the end, the pages modified in the buffer pool are written to the file, which the mapping shares.
+ */
+void file_begin_update(int table_id);
+void file_end_update(int table_id);
+
+/*
+ *  Free an on-disk page to the free space map of its range, or to the free page list beyond the ranges of the maps
+ */
+void file_free_page(int table_id, pagenum_t pagenum);
+
+/*
+ *  Allocate an on-disk page from the free space maps, preferring the one nearest to the given page,
+ *  or from the extent preallocated at the end of the file, which doubles as the file grows.
+ *  Return the offset of the page.
+ */
+pagenum_t file_alloc_page(int table_id, pagenum_t near = HEADER_PAGE_NUM);
+
+/*
+ *  Save the page numbers of the working set of the table (the hottest first)
+ *  into the warm file next to the data file.
+ */
+void file_save_working_set(int table_id, const std::vector<pagenum_t>& pages);
+
+/*
+ *  Load the saved working set of the table, which is removed as it is used,
+ *  and drop the page numbers beyond the end of the file.
+ */
+std::vector<pagenum_t> file_load_working_set(int table_id);
+
+/*  Return the number of columns of the table specified by the given table_id.
+ */
+int getNumOfCols(int table_id) noexcept;
+
 #endif
\ No newline at end of file
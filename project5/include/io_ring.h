@@ -0,0 +1,92 @@
+#ifndef __IO_RING_H__
+#define __IO_RING_H__
+
+#include "types.h"
+
+#include <memory>
+#include <vector>
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+
+/*
+ *  An io_uring instance of the calling thread, driven through the raw system calls.
+ *  - Each thread which submits asynchronous I/O gets its own ring, so it takes no latch.
+ *  - A request is submitted at once, and its callback is called by the submitting thread
+ *    when wait() reaps its completion. (so the callback may release the latches taken by the thread)
+ *  - Up to IO_QUEUE_DEPTH requests are in flight. A submission beyond that reaps one first.
+ *  - A callback must neither submit nor wait on the ring.
+ */
+class IoRing
+{
+private:
+	/* A request in flight: one or two linked submissions, and the callback to call once both complete */
+	struct Request
+	{
+		io_callback done;
+		void* arg;
+		int64_t result;
+		int64_t expected;
+		int pending;
+		std::vector<iovec> iov;
+	};
+
+	int fd;
+
+	/* Submission queue */
+	void* sq_ring;
+	size_t sq_ring_size;
+	unsigned* sq_head;
+	unsigned* sq_tail;
+	unsigned sq_mask;
+	unsigned* sq_array;
+	io_uring_sqe* sqes;
+	size_t sqes_size;
+
+	/* Completion queue */
+	void* cq_ring;
+	size_t cq_ring_size;
+	unsigned* cq_head;
+	unsigned* cq_tail;
+	unsigned cq_mask;
+	io_uring_cqe* cqes;
+
+	std::unique_ptr<Request[]> requests;
+	std::vector<Request*> free_requests;
+	int num_in_flight;
+	/* The submissions filled but not handed to the kernel yet */
+	unsigned num_queued;
+
+	IoRing();
+	bool setup(unsigned entries);
+
+	Request* newRequest(io_callback done, void* arg, int64_t expected);
+	io_uring_sqe* nextSubmission();
+	/* Hand the queued submissions to the kernel, and wait for min_complete completions. */
+	void enter(unsigned min_complete);
+	/* Call the callbacks of the completions which have arrived, and return the number of requests done. */
+	int reap();
+
+public:
+	IoRing(const IoRing&) = delete;
+	~IoRing();
+
+	/* The ring of the calling thread. It is set up on the first call, and nullptr if io_uring is not available. */
+	static IoRing* local();
+	/* The ring of the calling thread if it has been set up. */
+	static IoRing* current();
+
+	/* Read len bytes at the offset of the file into buf. */
+	void read(int file, void* buf, size_t len, off_t offset, io_callback done, void* arg);
+	/* Write the buffers to the file from the offset, followed by a data sync if sync is set. */
+	void writev(int file, std::vector<iovec>&& iov, off_t offset, bool sync, io_callback done, void* arg);
+
+	/* Reap completions until no more than max_in_flight requests are in flight. */
+	void wait(int max_in_flight = 0);
+
+	int countInFlight() const
+	{
+		return num_in_flight;
+	};
+};
+
+#endif
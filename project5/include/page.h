@@ -1,159 +1,202 @@
-#ifndef __PAGE_H__
-#define __PAGE_H__
-
-#include "types.h"
-#include <vector>
-#include <cstring>
-
-// Universal Page Layout
-class Page
-{
-private:
-	union
-	{
-		byte page[4096];
-		/* Header Page Layout */
-		struct
-		{
-			offset_t free_page_offset;
-			offset_t root_page_offset;
-			pagenum_t num_of_pages;
-			table_colnum_t num_of_columns;
-			byte reserved0[4064];
-		};
-		/* Free Page Layout */
-		struct
-		{
-			offset_t next_free_page_offset;
-			byte not_used[4088];
-		};
-		/* Internal/Leaf Node Page Layout */
-		struct
-		{
-			offset_t offset;    // Parent page offset
-			uint32_t isLeafNode;    // Leaf(1) / Internal(0)
-			uint32_t num_keys;  // The number of keys : Maximum Internal Page(249), Leaf Page(31)
-			byte reserved1[104]; // Reserved Area
-			union
-			{
-				// One More Page Offset
-				offset_t one_more_page_offset; // (leftmost child) for internal page
-				// Right Sibling Page Offset
-				offset_t right_sibling_page_offset; // (next page offset) for leaf page
-			};
-			union
-			{
-				// Key Pairs
-				key_pair pairs[DEFAULT_INTERNAL_ORDER - 1];  // for internal page
-				// Data Records
-				record_t records[DEFAULT_LEAF_ORDER - 1]; // for leaf page
-			};
-		};
-	};
-public:
-	Page();
-	Page(const Page& copy) = delete;
-
-	// for Header Page
-
-	// -> Getters
-	offset_t getFreePageOffset() const
-	{
-		return free_page_offset;
-	};
-
-	offset_t getRootPageOffset() const
-	{
-		return root_page_offset;
-	};
-
-	pagenum_t getNumOfPages() const
-	{
-		return num_of_pages;
-	}
-
-	pagenum_t getNumOfColumns() const
-	{
-		return num_of_columns;
-	}
-
-	// -> Setters
-	void setFreePageOffset(offset_t free_page_offset);
-	void setRootPageOffset(offset_t root_page_offset);
-	void setNumOfPages(pagenum_t num_of_page);
-	void setNumOfColumns(table_colnum_t num_of_column);
-
-	// for Free Page
-
-	// -> Getters
-	offset_t getNextFreePageOffset() const
-	{
-		return next_free_page_offset;
-	};
-
-	// -> Setters
-	void setNextFreePageOffset(offset_t next_free_page_offset);
-
-	// for Node Page
-
-	// -> Getters
-	offset_t getParentOffset() const
-	{
-		return offset;
-	};
-	bool isLeaf() const
-	{
-		return isLeafNode;
-	};
-	int getNumOfKeys() const
-	{
-		return num_keys;
-	};
-	record_key_t getKey(key_idx_t index) const
-	{
-		return !isLeaf() ?
-			// Internal Page : 0 ≤ index < DEFAULT_INTERNAL_ORDER - 1
-			index >= DEFAULT_INTERNAL_ORDER - 1 ? INVALID_INDEX : this->pairs[index].key :
-			// Leaf Page : 0 ≤ index < DEFAULT_LEAF_ORDER - 1
-			index >= DEFAULT_LEAF_ORDER - 1 ? INVALID_INDEX : this->records[index].key;
-	};
-	offset_t getOffset(key_idx_t index) const
-	{
-		return !isLeaf() ?
-			// Internal Page : 0 ≤ index < DEFAULT_INTERNAL_ORDER
-			index >= DEFAULT_INTERNAL_ORDER | index < 0 ? INVALID_INDEX :
-			index == 0 ? this->one_more_page_offset : this->pairs[index - 1].offset :
-			// Leaf Page : index = DEFAULT_LEAF_ORDER - 1
-			index == DEFAULT_LEAF_ORDER - 1 ? this->right_sibling_page_offset : INVALID_INDEX;
-	};
-	int getValues(key_idx_t index, record_val_t *dest, int num_column = 0) const
-	{
-		// Leaf Page : 0 ≤ index < DEFAULT_LEAF_ORDER - 1
-		return isLeaf() ?
-			index >= DEFAULT_LEAF_ORDER - 1 ? INVALID_INDEX
-			: (std::memcpy(dest, this->records[index].values, num_column * sizeof(record_val_t)), SUCCESS) :
-			INVALID_PAGE;
-	}
-
-	std::vector<record_val_t> getRecord(key_idx_t index, int num_column = 0);
-
-	// -> Setters
-	int setParentOffset(offset_t offset);
-	int setLeaf();
-	int setInternal();
-	int setNumOfKeys(key_idx_t num_keys);
-	int setKey(key_idx_t index, record_key_t key);
-	int setOffset(key_idx_t index, offset_t offset);
-	int setValues(key_idx_t index, const record_val_t* src, int num_column = 0);
-
-	// -> Key Search Utility Functions
-	int binarySearch(record_key_t key) const;
-	int binaryRangeSearch(record_key_t key) const;
-
-	void clear();
-
-	void* operator&();
-	const void* operator&() const;
-};
-
+#ifndef __PAGE_H__
+#define __PAGE_H__
+
+#include "types.h"
+#include <vector>
+#include <cstring>
+
+// Universal Page Layout
+// A page is aligned to its size wherever it is, so that it can be transferred with direct I/O.
+class alignas(PAGESIZE) Page
+{
+private:
+	union
+	{
+		byte page[4096];
+		/* Header Page Layout */
+		struct
+		{
+			offset_t free_page_offset;
+			offset_t root_page_offset;
+			pagenum_t num_of_pages;
+			table_colnum_t num_of_columns;
+			pagenum_t free_map_pages[MAX_FREE_MAP_PAGES]; // 0 until a page of the range is freed
+			byte reserved0[4064 - 8 * MAX_FREE_MAP_PAGES];
+		};
+		/* Free Page Layout (the free page list of the older files) */
+		struct
+		{
+			offset_t next_free_page_offset;
+			byte not_used[4088];
+		};
+		/* Free Space Map Page Layout */
+		// It is made a leaf page without records, so that the buffer pool writes it as it is.
+		struct
+		{
+			byte node_header[128];
+			uint64_t free_map[PAGES_PER_FREE_MAP / 64]; // 1 for a free page
+		};
+		/* Internal/Leaf Node Page Layout */
+		struct
+		{
+			offset_t offset;    // Parent page offset
+			uint32_t isLeafNode;    // Leaf(1) / Internal(0)
+			uint32_t num_keys;  // The number of keys : Maximum Internal Page(249), Leaf Page(31)
+			byte reserved1[104]; // Reserved Area
+			union
+			{
+				// One More Page Offset
+				offset_t one_more_page_offset; // (leftmost child) for internal page
+				// Right Sibling Page Offset
+				offset_t right_sibling_page_offset; // (next page offset) for leaf page
+			};
+			union
+			{
+				// Key Pairs
+				key_pair pairs[DEFAULT_INTERNAL_ORDER - 1];  // for internal page
+				// Data Records
+				record_t records[DEFAULT_LEAF_ORDER - 1]; // for leaf page
+			};
+		};
+	};
+public:
+	Page();
+	Page(const Page& copy) = delete;
+
+	// for Header Page
+
+	// -> Getters
+	offset_t getFreePageOffset() const
+	{
+		return free_page_offset;
+	};
+
+	offset_t getRootPageOffset() const
+	{
+		return root_page_offset;
+	};
+
+	pagenum_t getNumOfPages() const
+	{
+		return num_of_pages;
+	}
+
+	pagenum_t getNumOfColumns() const
+	{
+		return num_of_columns;
+	}
+
+	pagenum_t getFreeMapPage(int index) const
+	{
+		return free_map_pages[index];
+	}
+
+	// -> Setters
+	void setFreePageOffset(offset_t free_page_offset);
+	void setRootPageOffset(offset_t root_page_offset);
+	void setNumOfPages(pagenum_t num_of_page);
+	void setNumOfColumns(table_colnum_t num_of_column);
+	void setFreeMapPage(int index, pagenum_t pagenum);
+
+	// for Free Page
+
+	// -> Getters
+	offset_t getNextFreePageOffset() const
+	{
+		return next_free_page_offset;
+	};
+
+	// -> Setters
+	void setNextFreePageOffset(offset_t next_free_page_offset);
+
+	// for Free Space Map Page (index: the page number within the range of the map)
+
+	// -> Getters
+	bool isFreeInMap(int index) const
+	{
+		return free_map[index / 64] >> (index % 64) & 1;
+	};
+	// The number of free pages in the map
+	int countFreeInMap() const;
+	// The first free page from the given index (or the last one before it), or -1 if there is none
+	int findFreeInMap(int near) const;
+
+	// -> Setters
+	void setFreeInMap(int index, bool free);
+
+	// for Node Page
+
+	// -> Getters
+	offset_t getParentOffset() const
+	{
+		return offset;
+	};
+	bool isLeaf() const
+	{
+		return isLeafNode;
+	};
+	int getNumOfKeys() const
+	{
+		return num_keys;
+	};
+	record_key_t getKey(key_idx_t index) const
+	{
+		return !isLeaf() ?
+			// Internal Page : 0 ≤ index < DEFAULT_INTERNAL_ORDER - 1
+			index >= DEFAULT_INTERNAL_ORDER - 1 ? INVALID_INDEX : this->pairs[index].key :
+			// Leaf Page : 0 ≤ index < DEFAULT_LEAF_ORDER - 1
+			index >= DEFAULT_LEAF_ORDER - 1 ? INVALID_INDEX : this->records[index].key;
+	};
+	offset_t getOffset(key_idx_t index) const
+	{
+		return !isLeaf() ?
+			// Internal Page : 0 ≤ index < DEFAULT_INTERNAL_ORDER
+			index >= DEFAULT_INTERNAL_ORDER | index < 0 ? INVALID_INDEX : unswizzle(getChildEntry(index)) :
+			// Leaf Page : index = DEFAULT_LEAF_ORDER - 1
+			index == DEFAULT_LEAF_ORDER - 1 ? this->right_sibling_page_offset : INVALID_INDEX;
+	};
+	// Internal Page : the child offset as it is stored, which may be swizzled. (0 ≤ index < DEFAULT_INTERNAL_ORDER)
+	offset_t getChildEntry(key_idx_t index) const
+	{
+		return index == 0 ? this->one_more_page_offset : this->pairs[index - 1].offset;
+	};
+	// The page offset which a child entry stands for
+	static offset_t unswizzle(offset_t entry)
+	{
+		return entry & SWIZZLED_BIT ? (entry & SWIZZLE_PGNUM_MASK) * PAGESIZE : entry;
+	};
+	int getValues(key_idx_t index, record_val_t *dest, int num_column = 0) const
+	{
+		// Leaf Page : 0 ≤ index < DEFAULT_LEAF_ORDER - 1
+		return isLeaf() ?
+			index >= DEFAULT_LEAF_ORDER - 1 ? INVALID_INDEX
+			: (std::memcpy(dest, this->records[index].values, num_column * sizeof(record_val_t)), SUCCESS) :
+			INVALID_PAGE;
+	}
+
+	std::vector<record_val_t> getRecord(key_idx_t index, int num_column = 0);
+
+	// -> Setters
+	int setParentOffset(offset_t offset);
+	int setLeaf();
+	int setInternal();
+	int setNumOfKeys(key_idx_t num_keys);
+	int setKey(key_idx_t index, record_key_t key);
+	int setOffset(key_idx_t index, offset_t offset);
+	int setValues(key_idx_t index, const record_val_t* src, int num_column = 0);
+
+	// -> Pointer Swizzling
+	void swizzleChildEntry(key_idx_t index, offset_t expected, offset_t entry);
+	void copyUnswizzled(Page& dest) const;
+
+	// -> Key Search Utility Functions
+	int binarySearch(record_key_t key) const;
+	int binaryRangeSearch(record_key_t key) const;
+
+	void clear();
+
+	void* operator&();
+	const void* operator&() const;
+};
+
 #endif
\ No newline at end of file
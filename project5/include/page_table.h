@@ -0,0 +1,72 @@
+#ifndef __PAGE_TABLE_H__
+#define __PAGE_TABLE_H__
+
+#include "types.h"
+
+#include <atomic>
+#include <vector>
+
+class BufferBlock;
+
+/*
+ *  Page table of a buffer partition: (table id, page number) key -> resident buffer block
+ *  - Open addressing with linear probing, kept at most half full.
+ *  - Only one writer at a time: insert(), erase() and reserve() are called with the partition latch held.
+ *  - find() takes no latch. It may miss a page which is being moved by an erase,
+ *    or return a block which doesn't hold the page any more,
+ *    so the caller must check the block after pinning it, and fall back to the latch on a miss.
+ *  - The slot arrays outgrown by reserve() are kept until the table is destroyed,
+ *    since a reader may still be probing them.
+ */
+class PageTable
+{
+private:
+	/* A key of 0 marks an empty slot. (The table ids start from 1.) */
+	struct Slot
+	{
+		std::atomic<uint64_t> key;
+		std::atomic<BufferBlock*> block;
+	};
+	struct Slots
+	{
+		Slot* slots;
+		size_t mask;
+	};
+
+	std::atomic<Slots*> current;
+	std::vector<Slots*> outgrown;
+	size_t size;
+
+	static Slots* allocate(size_t capacity);
+	/* A mix apart from the Fibonacci hash, which has already chosen the partition. */
+	static size_t home(uint64_t key, size_t mask)
+	{
+		key ^= key >> 33;
+		key *= 0xFF51AFD7ED558CCDull;
+		key ^= key >> 33;
+		return key & mask;
+	};
+	void place(Slots* table, uint64_t key, BufferBlock* block);
+
+public:
+	PageTable();
+	PageTable(const PageTable&) = delete;
+	~PageTable();
+
+	/* Return the block mapped from the key, or nullptr. (without the latch) */
+	BufferBlock* find(uint64_t key) const;
+
+	/* Map the key to the block. */
+	void insert(uint64_t key, BufferBlock* block);
+
+	/* Remove the key, shifting the following entries back into its slot. */
+	void erase(uint64_t key);
+
+	/* Make room for n keys. */
+	void reserve(size_t n);
+
+	/* Remove every key. */
+	void clear();
+};
+
+#endif
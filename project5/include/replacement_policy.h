@@ -0,0 +1,193 @@
+#ifndef __REPLACEMENT_POLICY_H__
+#define __REPLACEMENT_POLICY_H__
+
+#include "types.h"
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+class BufferBlock;
+
+/*
+ *  Additional condition on a victim, which honors the buffer quotas of the tables.
+ *  - table_id: the table which needs a frame.
+ *  - max_priority: only the blocks of the tables in this priority class or lower are chosen.
+ *  - only_own_table: only the blocks of the table itself are chosen, since it is at its maximum.
+ *  - honor_quotas: whether the three conditions above apply.
+ *  - spare_index_pages: the blocks in the index region are not chosen.
+ */
+struct VictimFilter
+{
+	int table_id;
+	buffer_priority max_priority;
+	bool only_own_table;
+	bool honor_quotas;
+	bool spare_index_pages;
+};
+
+/*
+ *  Replacement policy of a buffer partition.
+ *  Every method except access() is called with the partition latch held.
+ */
+class ReplacementPolicy
+{
+public:
+	/*
+	 *  Make a replacement policy of the given type.
+	 */
+	static ReplacementPolicy* create(policy_type type);
+
+	virtual ~ReplacementPolicy() = default;
+
+	/*
+	 *  Register a new buffer block to be managed by this policy.
+	 */
+	virtual void add(BufferBlock* block) = 0;
+
+	/*
+	 *  Stop managing the unpinned block, which is taken out of the buffer pool.
+	 */
+	virtual void remove(BufferBlock* block) = 0;
+
+	/*
+	 *  Notify that a new page has been read into the block.
+	 */
+	virtual void load(BufferBlock*)
+	{
+
+	};
+
+	/*
+	 *  Notify that the page of the block is evicted. It is called once the victim has been claimed,
+	 *  while the block still holds the page.
+	 */
+	virtual void evict(BufferBlock*)
+	{
+
+	};
+
+	/*
+	 *  Record an access to the block. It is called whenever the block is unpinned.
+	 */
+	virtual void access(BufferBlock* block) = 0;
+
+	/*
+	 *  Choose an unpinned block to be replaced.
+	 *  If clean_only is set, dirty blocks are not chosen either.
+	 *  If filter is given, only the blocks accepted by it are chosen.
+	 *  If there is no such block, return nullptr.
+	 */
+	virtual BufferBlock* victim(bool clean_only = false, const VictimFilter* filter = nullptr) = 0;
+
+	/*
+	 *  Append up to n blocks to dest, starting from the one
+	 *  which is going to be replaced first.
+	 */
+	virtual void coldest(std::vector<BufferBlock*>& dest, size_t n) = 0;
+
+	/*
+	 *  Whether access() can be called without the partition latch.
+	 */
+	virtual bool isLatchFree() const = 0;
+
+protected:
+	/*
+	 *  Whether the block can be replaced right now.
+	 */
+	static bool isReplaceable(const BufferBlock* block, bool clean_only, const VictimFilter* filter = nullptr);
+};
+
+/*
+ *  LRU: blocks are kept in a circular, doubly-linked list
+ *  and an accessed block is moved to the front of the list.
+ */
+class LRUPolicy : public ReplacementPolicy
+{
+private:
+	/* pool is the least recently used block and pool->next is the most recently used one. */
+	BufferBlock* pool;
+public:
+	LRUPolicy();
+	void add(BufferBlock* block);
+	void remove(BufferBlock* block);
+	void access(BufferBlock* block);
+	BufferBlock* victim(bool clean_only = false, const VictimFilter* filter = nullptr);
+	void coldest(std::vector<BufferBlock*>& dest, size_t n);
+	bool isLatchFree() const
+	{
+		return false;
+	};
+};
+
+/*
+ *  CLOCK: an accessed block only gets its reference bit set.
+ *  The clock hand gives a second chance to the referenced blocks.
+ */
+class ClockPolicy : public ReplacementPolicy
+{
+private:
+	std::vector<BufferBlock*> blocks;
+	size_t hand;
+public:
+	ClockPolicy();
+	void add(BufferBlock* block);
+	void remove(BufferBlock* block);
+	void access(BufferBlock* block);
+	BufferBlock* victim(bool clean_only = false, const VictimFilter* filter = nullptr);
+	void coldest(std::vector<BufferBlock*>& dest, size_t n);
+	bool isLatchFree() const
+	{
+		return true;
+	};
+};
+
+/*
+ *  2Q: a page referenced once stays in the FIFO queue A1in,
+ *  and only a page referenced again after leaving A1in (remembered in
+ *  the ghost queue A1out) is promoted to the LRU queue Am.
+ *  A table scan thus cycles through A1in without flushing the hot pages in Am.
+ */
+class TwoQPolicy : public ReplacementPolicy
+{
+private:
+	enum queue_type
+	{
+		FREE, A1IN, AM
+	};
+
+	/* Doubly-linked queue of the blocks: head is the most recent one. */
+	struct Queue
+	{
+		BufferBlock *head, *tail;
+		size_t size;
+	};
+
+	Queue free_queue, a1in, am;
+	/* A1out: the page ids recently evicted from A1in */
+	std::list<uint64_t> a1out;
+	std::unordered_map<uint64_t, std::list<uint64_t>::iterator> a1out_index;
+	/* The number of blocks managed by this policy */
+	size_t size;
+
+	Queue& queueOf(BufferBlock* block);
+	void pushFront(Queue& queue, BufferBlock* block);
+	void unlink(BufferBlock* block);
+	BufferBlock* replaceableFromTail(Queue& queue, bool clean_only, const VictimFilter* filter);
+	void remember(BufferBlock* block);
+public:
+	TwoQPolicy();
+	void add(BufferBlock* block);
+	void remove(BufferBlock* block);
+	void load(BufferBlock* block);
+	void evict(BufferBlock* block);
+	void access(BufferBlock* block);
+	BufferBlock* victim(bool clean_only = false, const VictimFilter* filter = nullptr);
+	void coldest(std::vector<BufferBlock*>& dest, size_t n);
+	bool isLatchFree() const
+	{
+		return false;
+	};
+};
+
+#endif
@@ -1,6 +1,6 @@
-#ifndef __TRX_MANAGER_H__
-#define __TRX_MANAGER_H__
-
-
-
+#ifndef __TRX_MANAGER_H__
+#define __TRX_MANAGER_H__
+
+
+
 #endif
\ No newline at end of file
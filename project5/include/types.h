@@ -1,71 +1,122 @@
-#ifndef __TYPES_H__
-#define __TYPES_H__
-
-#include "constants.h"
-#include <cassert>
-#include <iostream>
-#include <list>
-#include <pthread.h>
-
-// TYPES.
-
-// Type Redefinition
-using byte = char;
-using key_idx_t = int32_t ;
-using record_key_t = int64_t;
-using record_val_t = int64_t;
-using table_colnum_t = uint64_t;
-using pagenum_t = uint64_t;
-using offset_t = uint64_t;
-using thread = pthread_t;
-using latch = pthread_mutex_t;
-
-// Type Definition
-
-/* Record format for storing the records */
-struct record_t
-{
-    record_key_t key;
-	record_val_t values[MAX_NUM_COLUMNS - 1];
-};
-
-/* Key Pair */
-struct key_pair
-{
-    record_key_t key;
-    offset_t offset;
-};
-
-class Page;
-struct lock_t;
-struct trx_t;
-
-std::ostream& operator<<(std::ostream& os, const record_t& record);
-
-enum lock_mode
-{
-	SHARED, EXCLUSIVE
-};
-
-enum trx_state
-{
-	IDLE, RUNNING, WAITING
-};
-
-struct lock_t
-{
-	int tid; // table id
-	int rid; // record id or key
-	lock_mode mode; // lock mode
-	trx_t* trx; // backpointer to lock holder
-};
-
-struct trx_t
-{
-	int tid; // table id
-	trx_state state; // transaction state
-	std::list<lock_t*> trx_locks; // list of holding locks
-	lock_t* wait_lock; // lock object that trx is waiting
-};
-
+#ifndef __TYPES_H__
+#define __TYPES_H__
+
+#include "constants.h"
+#include <cassert>
+#include <iostream>
+#include <list>
+#include <pthread.h>
+
+// TYPES.
+
+// Type Redefinition
+using byte = char;
+using key_idx_t = int32_t ;
+using record_key_t = int64_t;
+using record_val_t = int64_t;
+using table_colnum_t = uint64_t;
+using pagenum_t = uint64_t;
+using offset_t = uint64_t;
+using thread = pthread_t;
+using latch = pthread_mutex_t;
+using rw_latch = pthread_rwlock_t;
+/* Completion of an asynchronous I/O: the argument given at the submission, and the number of bytes or -errno */
+using io_callback = void (*)(void* arg, int64_t result);
+
+// Type Definition
+
+/* Record format for storing the records */
+struct record_t
+{
+    record_key_t key;
+	record_val_t values[MAX_NUM_COLUMNS - 1];
+};
+
+/* Key Pair */
+struct key_pair
+{
+    record_key_t key;
+    offset_t offset;
+};
+
+class Page;
+struct lock_t;
+struct trx_t;
+
+std::ostream& operator<<(std::ostream& os, const record_t& record);
+
+enum lock_mode
+{
+	SHARED, EXCLUSIVE
+};
+
+enum trx_state
+{
+	IDLE, RUNNING, WAITING
+};
+
+enum policy_type
+{
+	LRU, CLOCK, TWO_Q
+};
+
+enum frame_backing
+{
+	NORMAL_PAGES, TRANSPARENT_HUGE_PAGES, EXPLICIT_HUGE_PAGES
+};
+
+enum buffer_priority
+{
+	LOW_PRIORITY, NORMAL_PRIORITY, HIGH_PRIORITY
+};
+
+enum durability_mode
+{
+	FULL_SYNC, CHECKPOINT_SYNC, NO_SYNC
+};
+
+enum io_backend
+{
+	SYNC_IO, IO_URING
+};
+
+enum table_mode
+{
+	BUFFERED, MEMORY_MAPPED, DIRECT_IO
+};
+
+/* Buffer pool statistics */
+struct buffer_stats
+{
+	uint64_t hits; // requests served from the buffer pool
+	uint64_t misses; // requests which read the page from the disk
+	uint64_t prefetches; // pages read from the disk ahead of a scan
+	uint64_t evictions; // pages replaced by other pages
+	uint64_t index_evictions; // internal and header pages among them
+	uint64_t write_backs; // dirty pages written to the disk
+	uint64_t pin_waits; // requests which found every frame pinned and waited for one to be unpinned
+	uint64_t pin_wait_ns;
+	uint64_t pin_timeouts; // requests which gave up waiting (starved)
+	uint64_t partition_latch_waits; // partition latch acquisitions which had to wait
+	uint64_t partition_latch_wait_ns;
+	uint64_t frame_latch_waits; // frame latch acquisitions which had to wait
+	uint64_t frame_latch_wait_ns;
+};
+
+struct lock_t
+{
+	int tid; // table id
+	int rid; // record id or key
+	lock_mode mode; // lock mode
+	trx_t* trx; // backpointer to lock holder
+};
+
+struct trx_t
+{
+	int tid; // table id
+	trx_state state; // transaction state
+	std::list<lock_t*> trx_locks; // list of holding locks
+	lock_t* wait_lock; // lock object that trx is waiting
+};
+
 #endif
\ No newline at end of file
@@ -1,135 +1,250 @@
-#include "bpt.h"
-
-#include "index_and_file_manager.h"
-#include "buffer_manager.h"
-#include "disk_manager.h"
-
-#include <cstring>
-#include <string>
-
-/*
- * Initialize buffer pool with given number and buffer manager.
- */
-int init_db(int buf_num) {
-	return BufferManager::init(buf_num);
-}
-
-/*
- * Open existing data file using ‘pathname’ or create one if not existed.
- * If success, return table_id.
- */
-int open_table(char * pathname, int num_column) {
-	const auto tid = file_open_table(pathname, num_column);
-	return tid;
-}
-
-/*
- * Write the pages relating to this table to disk and close the table.
- *  - Write all pages of this table from buffer to disk and discard the table id.
- *  - If success, return 0. Otherwise, return non-zero value.
- */
-int close_table(int table_id) {
-	return file_close_table(table_id);
-}
-
-/*
- * Destroy buffer manager.
- *  - Flush all data from buffer and destroy allocated buffer.
- *  - If success, return 0. Otherwise, return non-zero value.
- */
-int shutdown_db(void) {
-	BufferManager::shutdown();
-	return SUCCESS;
-}
-
-/*
- *  Find the record containing input ‘key’.
- *  If found matching ‘key’, return matched ‘value’ string. Otherwise, return NULL.
- */
-int64_t* find(int table_id, int64_t key) {
-	record_t* record;
-	offset_t root_offset;
-	int num_cols;
-	
-	{
-		auto buf_header = BufferManager::get_frame(table_id, HEADER_PAGE_NUM);
-		auto page = BufferManager::get_page(buf_header, false);
-		root_offset = page->getRootPageOffset();
-		num_cols = page->getNumOfColumns();
-		BufferManager::put_frame(buf_header);
-	}
-	
-	if ((record = find_record(table_id, root_offset, key)) == nullptr || num_cols < 2 || num_cols > MAX_NUM_COLUMNS )
-		return NULL;
-
-	// Copy the contents
-	int64_t* result_values = new int64_t[num_cols - 1];
-	std::memcpy(result_values, record->values, (num_cols - 1) * sizeof(record_val_t));
-	
-	// remove record
-	delete record;
-
-	// return the values
-	return result_values;
-}
-
-/*
- *  Insert input ‘key/value’ (record) to data file at the right place.
- *  If success, return 0. Otherwise, return non-zero value.
- */
-int insert(int table_id, int64_t key, int64_t* values) {
-	record_t record = record_t();
-	offset_t root_offset;
-	int num_cols;
-
-	{
-		auto buf_header = BufferManager::get_frame(table_id, HEADER_PAGE_NUM);
-		auto page = BufferManager::get_page(buf_header, false);
-		root_offset = page->getRootPageOffset();
-		num_cols = page->getNumOfColumns();
-		BufferManager::put_frame(buf_header);
-	}
-
-	// Set the data
-	record.key = key;
-	std::memcpy(record.values, values, (num_cols - 1) * sizeof(record_val_t));
-
-	// Insert the record
-	root_offset = insert_record(table_id, root_offset, &record);
-
-	if (root_offset == KEY_EXIST)
-		return KEY_EXIST;
-	
-	{
-		// Update the root offset
-		auto buf_header = BufferManager::get_frame(table_id, HEADER_PAGE_NUM);
-		BufferManager::get_page(buf_header, true)->setRootPageOffset(root_offset);
-		BufferManager::put_frame(buf_header);
-	}
-
-	return SUCCESS;
-}
-
-/*
- *  Find the matching record and delete it if found.
- *  If success, return 0. Otherwise, return non-zero value.
- */
-int erase(int table_id, int64_t key) {
-	auto buf_header = BufferManager::get_frame(table_id, HEADER_PAGE_NUM);
-	offset_t root_offset = BufferManager::get_page(buf_header, false)->getRootPageOffset();
-	BufferManager::put_frame(buf_header);
-
-	// Insert the record
-	root_offset = delete_record(table_id, root_offset, key );
-
-	if (root_offset != KEY_EXIST) {
-		// Get the buffer block
-		buf_header = BufferManager::get_frame(table_id, HEADER_PAGE_NUM);
-		// Reset the Root Page Offset.
-		BufferManager::get_page(buf_header, true)->setRootPageOffset(root_offset);
-		// Put it back to the buffer.
-		BufferManager::put_frame(buf_header);
-		return 0;
-	}
-	return -1;
+#include "bpt.h"
+
+#include "index_and_file_manager.h"
+#include "buffer_manager.h"
+#include "disk_manager.h"
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+/*
+ * Whether shutdown_db() dumps the buffer pool statistics (see set_buffer_stats_dump())
+ */
+static bool dump_buffer_stats = true;
+
+/*
+ * Initialize buffer pool with given number and buffer manager.
+ * The buffer pool is split into the given number of partitions
+ * and managed by the given replacement policy.
+ * The page frames are backed by the given kind of memory pages.
+ * The batched reads and writes go through the given I/O backend. (IO_URING falls back to SYNC_IO)
+ */
+int init_db(int buf_num, int num_partitions, policy_type policy, frame_backing backing, io_backend io) {
+	int result = BufferManager::init(buf_num, num_partitions, policy, backing);
+	if(result == SUCCESS)
+		file_set_io_backend(io);
+	return result;
+}
+
+/*
+ * Grow or shrink the buffer pool to the given number without shutting it down.
+ *  - Shrinking writes back and drops unpinned buffers only.
+ *  - If success, return 0. Otherwise, return non-zero value.
+ */
+int resize_db(int buf_num) {
+	return BufferManager::resize(buf_num);
+}
+
+/*
+ * Set the buffer quota of the table.
+ *  - The buffers of the table are not taken by the other tables while it holds no more than min_buf_num.
+ *  - Once it holds max_buf_num (0 for no limit), the table reuses its own buffers.
+ *  - The buffers of the tables in a lower priority class are replaced first.
+ *  - If success, return 0. Otherwise, return non-zero value.
+ */
+int set_buffer_quota(int table_id, int min_buf_num, int max_buf_num, buffer_priority priority) {
+	return BufferManager::set_table_quota(table_id, min_buf_num, max_buf_num, priority);
+}
+
+/*
+ * Return the number of buffers which hold the pages of the table.
+ */
+int get_buffer_occupancy(int table_id) {
+	return BufferManager::get_table_occupancy(table_id);
+}
+
+/*
+ * Turn the pointer swizzling of the child offsets on or off.
+ */
+void set_pointer_swizzling(bool enable) {
+	BufferManager::set_swizzling(enable);
+}
+
+/*
+ * Open existing data file using ‘pathname’ or create one if not existed.
+ * In MEMORY_MAPPED mode, the readers search the mapped file directly while it is not being updated.
+ * In DIRECT_IO mode, the pages bypass the OS page cache.
+ * If success, return table_id.
+ */
+int open_table(char * pathname, int num_column, table_mode mode) {
+	const auto tid = file_open_table(pathname, num_column, mode);
+	return tid;
+}
+
+/*
+ * Set the durability mode of the table, or of every table from now on if table_id is 0.
+ */
+int set_durability(int table_id, durability_mode mode) {
+	return file_set_durability(table_id, mode);
+}
+
+/*
+ * Write back the buffers of the table (every open table if 0) and make them durable.
+ */
+int checkpoint(int table_id) {
+	return file_checkpoint(table_id);
+}
+
+/*
+ * Write the pages relating to this table to disk and close the table.
+ *  - Write all pages of this table from buffer to disk and discard the table id.
+ *  - If success, return 0. Otherwise, return non-zero value.
+ */
+int close_table(int table_id) {
+	return file_close_table(table_id);
+}
+
+/*
+ * Destroy buffer manager.
+ *  - Flush all data from buffer and destroy allocated buffer.
+ *  - If success, return 0. Otherwise, return non-zero value.
+ */
+int shutdown_db(void) {
+	BufferManager::shutdown();
+	if (dump_buffer_stats)
+		BufferManager::print_stats(std::cerr);
+	return SUCCESS;
+}
+
+/*
+ * Get the buffer pool statistics summed up over every thread since the last reset.
+ */
+void get_buffer_stats(buffer_stats* stats) {
+	if (stats != nullptr)
+		BufferManager::get_stats(*stats);
+}
+
+/*
+ * Start the buffer pool statistics over from zero.
+ */
+void reset_buffer_stats(void) {
+	BufferManager::reset_stats();
+}
+
+/*
+ * Turn the dump of the buffer pool statistics at shutdown_db() on or off.
+ */
+void set_buffer_stats_dump(bool enable) {
+	dump_buffer_stats = enable;
+}
+
+/*
+ *  Find the record containing input ‘key’.
+ *  If found matching ‘key’, return matched ‘value’ string. Otherwise, return NULL.
+ */
+int64_t* find(int table_id, int64_t key) {
+	record_t* record;
+	offset_t root_offset;
+	int num_cols;
+	uint64_t version, structure_version;
+
+	// A mapped table is searched in the mapping, unless it is being updated.
+	if (find_record_mapped(table_id, key, record)) {
+		num_cols = getNumOfCols(table_id);
+	} else for (;;) {
+		// A split or a merge in the meantime makes it search again.
+		structure_version = structure_version_begin(table_id);
+
+		// Read the header page optimistically, or under a shared latch if it is being modified.
+		auto buf_header = BufferManager::get_frame_optimistic(table_id, HEADER_PAGE_NUM, version);
+		if (buf_header != nullptr) {
+			root_offset = buf_header->getPage().getRootPageOffset();
+			num_cols = buf_header->getPage().getNumOfColumns();
+		}
+		if (buf_header == nullptr || !BufferManager::validate(buf_header, version)) {
+			buf_header = BufferManager::get_frame(table_id, HEADER_PAGE_NUM, SHARED);
+			auto page = BufferManager::get_page(buf_header, false);
+			root_offset = page->getRootPageOffset();
+			num_cols = page->getNumOfColumns();
+			BufferManager::put_frame(buf_header);
+		}
+
+		record = find_record(table_id, root_offset, key);
+		if (structure_version_validate(table_id, structure_version))
+			break;
+		delete record;
+	}
+	
+	if (record == nullptr || num_cols < 2 || num_cols > MAX_NUM_COLUMNS )
+		return NULL;
+
+	// Copy the contents
+	int64_t* result_values = new int64_t[num_cols - 1];
+	std::memcpy(result_values, record->values, (num_cols - 1) * sizeof(record_val_t));
+	
+	// remove record
+	delete record;
+
+	// return the values
+	return result_values;
+}
+
+/*
+ *  Insert input ‘key/value’ (record) to data file at the right place.
+ *  If success, return 0. Otherwise, return non-zero value.
+ */
+int insert(int table_id, int64_t key, int64_t* values) {
+	record_t record = record_t();
+	offset_t root_offset;
+	int num_cols;
+
+	// A mapped table is updated in the buffer pool, and written to the file at the end.
+	file_begin_update(table_id);
+
+	{
+		auto buf_header = BufferManager::get_frame(table_id, HEADER_PAGE_NUM, SHARED);
+		auto page = BufferManager::get_page(buf_header, false);
+		root_offset = page->getRootPageOffset();
+		num_cols = page->getNumOfColumns();
+		BufferManager::put_frame(buf_header);
+	}
+
+	// Set the data
+	record.key = key;
+	std::memcpy(record.values, values, (num_cols - 1) * sizeof(record_val_t));
+
+	// Insert the record
+	root_offset = insert_record(table_id, root_offset, &record);
+
+	if (root_offset != static_cast<offset_t>(KEY_EXIST)) {
+		// Update the root offset
+		auto buf_header = BufferManager::get_frame(table_id, HEADER_PAGE_NUM, EXCLUSIVE);
+		BufferManager::get_page(buf_header, true)->setRootPageOffset(root_offset);
+		BufferManager::put_frame(buf_header);
+	}
+	// A split has been finished by the new root offset.
+	end_structure_change(table_id);
+
+	file_end_update(table_id);
+	return root_offset == static_cast<offset_t>(KEY_EXIST) ? KEY_EXIST : SUCCESS;
+}
+
+/*
+ *  Find the matching record and delete it if found.
+ *  If success, return 0. Otherwise, return non-zero value.
+ */
+int erase(int table_id, int64_t key) {
+	file_begin_update(table_id);
+
+	auto buf_header = BufferManager::get_frame(table_id, HEADER_PAGE_NUM, SHARED);
+	offset_t root_offset = BufferManager::get_page(buf_header, false)->getRootPageOffset();
+	BufferManager::put_frame(buf_header);
+
+	// Insert the record
+	root_offset = delete_record(table_id, root_offset, key );
+
+	if (root_offset != static_cast<offset_t>(KEY_EXIST)) {
+		// Get the buffer block
+		buf_header = BufferManager::get_frame(table_id, HEADER_PAGE_NUM, EXCLUSIVE);
+		// Reset the Root Page Offset.
+		BufferManager::get_page(buf_header, true)->setRootPageOffset(root_offset);
+		// Put it back to the buffer.
+		BufferManager::put_frame(buf_header);
+	}
+	// A merge has been finished by the new root offset.
+	end_structure_change(table_id);
+
+	file_end_update(table_id);
+	return root_offset != static_cast<offset_t>(KEY_EXIST) ? 0 : -1;
 }
\ No newline at end of file
@@ -1,347 +1,1795 @@
-#include "buffer_manager.h"
-#include "disk_manager.h"
-#include "macros.h"
-
-#include <cstring> /* memset */
-
-// Buffer Block
-
-BufferBlock::BufferBlock(int table_id, pagenum_t pgnum)
-	:frame(), table_id(table_id), pgnum(pgnum), dirty(false), pin_cnt(0), lock(PTHREAD_MUTEX_INITIALIZER)
-{
-
-}
-
-Page& BufferBlock::getPage()
-{
-	return frame;
-}
-
-// Buffer Management
-
-bool BufferManager::initialized = false;
-BufferBlock* BufferManager::pool = nullptr;
-latch BufferManager::global_lock;
-
-/*
- *  Initialize the buffer pool with the given number.
- *  
- *  - Initialize other fields (state info, LRU info..) with your own design.
- *  - If success, return 0.
- *  - Otherwise, return non-zero value.
- */
-int BufferManager::init(int buf_num){
-	BufferBlock* temp, *front = NULL;
-	
-	if(buf_num < 0)
-		return -1;
-
-	global_lock = PTHREAD_MUTEX_INITIALIZER;
-	
-	// Lock
-	pthread_mutex_lock(&BufferManager::global_lock);
-
-	// Form a circular, viz doubly-linked list.
-	while(buf_num--){
-		temp = new BufferBlock();
-		if(temp == NULL){
-			// Not Enough Memory
-			exit(-1);
-		}
-
-		// Allocate new buffer frames into the buffer pool.
-		if(front == NULL){
-			front = temp;
-			pool = front;
-		}else{
-			temp->prev = pool;
-			temp->prev->next = temp;
-			pool = temp;
-		}
-	}
-
-	temp->next = front;
-	temp->next->prev = temp;
-
-	pthread_mutex_unlock(&BufferManager::global_lock);
-
-	// Initialization is finished.
-	if(!initialized){
-		initialized = true;
-	}
-
-	return SUCCESS;
-}
-
-// It must be protected by the global lock at the caller method.
-void BufferManager::putAtFront(BufferBlock* p)
-{
-	/* Put it at the front of the list. */
-	if ( p == pool )
-	{
-		pool = pool->prev;
-	}
-	else
-	{
-		p->prev->next = p->next;
-		p->next->prev = p->prev;
-		p->prev = pool;
-		p->next = pool->next;
-		p->prev->next = p;
-		p->next->prev = p;
-	}
-}
-
-/*
- *  Get the buffer control block from the buffer pool.
- */
-BufferBlock* BufferManager::get_frame(int table_id, pagenum_t pagenum) {
-	if(!initialized)
-		return NULL;
-
-	pthread_mutex_lock(&BufferManager::global_lock);
-	BufferBlock* p = pool->next;
-	
-	/* 
-	 * If there is the requested page on the buffer, return it.
-	 */
-	while(p != NULL){
-		if(p->table_id && p->table_id == table_id && p->pgnum == pagenum){
-			pthread_mutex_lock(&p->lock);
-
-			/* Pinned */
-			++p->pin_cnt;
-
-			pthread_mutex_unlock(&p->lock);
-			pthread_mutex_unlock(&BufferManager::global_lock);
-			return p;
-		}
-
-		if(p == pool)
-			break;
-
-		/* Go to the next one. */
-		p = p->next;
-	}
-
-	/* Find an unpinned frame that can be used for replacement */
-	while(p != NULL){
-		if(p->pin_cnt == 0){
-			// Find a candidate for replacement
-			break;
-		}
-		p = p->prev;
-		if(p==pool){
-			pthread_mutex_unlock(&BufferManager::global_lock);
-			// No frames can be evicted.
-			return NULL;
-		}
-	}
-
-	// Evict
-
-	// If the page is dirty,
-	BufferManager::flush_frame(p);
-
-	// Get the page lock
-	pthread_mutex_lock(&p->lock);
-
-	// Refill the page metadata
-	p->table_id = table_id;
-	p->pgnum = pagenum;
-
-	// Read the page
-	file_read_page(p->table_id, p->pgnum, p->frame);
-
-	/* Pinned */
-	++p->pin_cnt;
-
-	pthread_mutex_unlock(&p->lock);
-	pthread_mutex_unlock(&BufferManager::global_lock);
-	return p;
-}
-
-/*
- *  Put the buffer block back to the buffer pool.
- */
-void BufferManager::put_frame(BufferBlock* src) {
-	if(!initialized)
-		return;
-
-	if(src == NULL)
-		return;
-
-	pthread_mutex_lock(&BufferManager::global_lock);
-	pthread_mutex_lock(&src->lock);
-
-	putAtFront(src);
-
-	/* Unpinned */
-	--src->pin_cnt;
-	
-	pthread_mutex_unlock(&src->lock);
-	pthread_mutex_unlock(&BufferManager::global_lock);	
-}
-
-/*
- *  Get the page and set whether this block gets dirty.
- */
-Page* BufferManager::get_page(BufferBlock* block, bool dirty){
-	if ( !block )
-		return nullptr;
-
-	pthread_mutex_lock(&block->lock);
-
-	block->dirty |= dirty;
-	
-	pthread_mutex_unlock(&block->lock);
-	
-	return static_cast<Page*>(&block->frame);
-}
-
-/*
-	 *  Request the allocatioin of a page to the disk manager
-	 *  and return the number of the new page.
-	 */
-pagenum_t BufferManager::buf_alloc_page(int table_id)
-{
-	return file_alloc_page(table_id);
-}
-
-/*
- *  Request the unused page to be free to the disk manager.
- */
-void BufferManager::buf_free_page(int table_id, pagenum_t page_to_be_free)
-{
-	file_free_page(table_id, page_to_be_free);
-}
-
-/*
- *  Flush the buffers of the given table and clear them.
- */
-void BufferManager::close_table(int table_id){
-	if(!initialized)
-		return;
-	
-	pthread_mutex_lock(&BufferManager::global_lock);
-	
-	BufferBlock* p = pool;
-	while(p != NULL){
-		pthread_mutex_lock(&p->lock);
-
-		if(p->table_id && p->table_id == table_id){
-			// If the page is dirty,
-			BufferManager::close_frame(p);
-		}
-
-		pthread_mutex_unlock(&p->lock);
-
-		p = p->prev;
-		if(p == pool)
-			break;
-	}
-
-	pthread_mutex_unlock(&BufferManager::global_lock);
-}
-
-/*
- *  Flush the specific buffer and clear it.
- */
-void BufferManager::close_frame(BufferBlock* frame){
-	if(!initialized)
-		return;
-
-	if(frame == NULL)
-		return;
-	
-	// Flush the buffer
-	BufferManager::flush_frame(frame);
-
-	pthread_mutex_lock(&BufferManager::global_lock);
-	pthread_mutex_lock(&frame->lock);
-
-	// Reset the information of the buffer block
-	frame->frame.clear();
-	frame->table_id = 0;
-	frame->pgnum = 0;
-
-	pthread_mutex_unlock(&frame->lock);
-	pthread_mutex_unlock(&BufferManager::global_lock);
-}
-
-/*
- *  Flush the buffers of the given table.
- */
-void BufferManager::flush_table(int table_id){
-	if(!initialized)
-		return;
-
-	pthread_mutex_lock(&BufferManager::global_lock);
-	BufferBlock* p = pool;
-	while(p != NULL){
-		pthread_mutex_lock(&p->lock);
-
-		if(p->table_id && p->table_id == table_id){
-			// If the page is dirty,
-			BufferManager::flush_frame(p);
-		}
-
-		pthread_mutex_unlock(&p->lock);
-	
-		p = p->prev;
-		if(p == pool)
-			break;
-	}
-	pthread_mutex_unlock(&BufferManager::global_lock);
-}
-
-/*
- *  Flush the specific buffer.
- */
-void BufferManager::flush_frame(BufferBlock* frame){
-	if(!initialized)
-		return;
-
-	if(frame == NULL)
-		return;
-	
-	pthread_mutex_lock(&frame->lock);
-	
-	++frame->pin_cnt;
-
-	if(frame->dirty){
-		file_write_page(frame->table_id, frame->pgnum, frame->frame);
-		frame->dirty = false;
-	}
-
-	--frame->pin_cnt;
-
-	pthread_mutex_unlock(&frame->lock);
-}
-
-/*
- *  Flush all buffers in the buffer pool and free the pool.
- */
-void BufferManager::shutdown(void)
-{
-	int i;
-	pthread_mutex_lock(&BufferManager::global_lock);
-	if ( pool )
-	{
-		BufferBlock* it, *next;
-
-		it = pool;
-		next = it->next;
-
-		while ( next != pool )
-		{
-			BufferManager::flush_frame(it);
-			delete it;
-			it = next;
-			next = it->next;
-		}
-
-		pool = NULL;
-	}
-	pthread_mutex_unlock(&BufferManager::global_lock);
-}
\ No newline at end of file
+#include "buffer_manager.h"
+#include "disk_manager.h"
+#include "macros.h"
+
+#include <algorithm> /* remove_if */
+#include <cerrno> /* ETIMEDOUT */
+#include <cstring> /* memset */
+#include <ctime> /* clock_gettime */
+#include <memory> /* unique_ptr, addressof */
+#include <new> /* placement new */
+#include <sched.h> /* sched_yield */
+#include <sys/mman.h> /* mmap, madvise */
+
+// Statistics
+
+enum stat_type
+{
+	HITS, MISSES, PREFETCHES, EVICTIONS, INDEX_EVICTIONS, WRITE_BACKS, PIN_WAITS, PIN_WAIT_NS, PIN_TIMEOUTS,
+	PARTITION_LATCH_WAITS, PARTITION_LATCH_WAIT_NS, FRAME_LATCH_WAITS, FRAME_LATCH_WAIT_NS,
+	NUM_OF_STATS
+};
+
+/*
+ *  Statistics slot (per thread)
+ *  Only its own thread writes to a slot, so counting is a plain load and store
+ *  to a cache line which no other thread writes to.
+ *  The slots are registered so that they can be summed up on demand,
+ *  and a slot is folded into the retired counters when its thread exits.
+ */
+struct alignas(64) StatsSlot
+{
+	std::atomic<uint64_t> counters[NUM_OF_STATS];
+
+	StatsSlot();
+	~StatsSlot();
+};
+
+static latch stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<StatsSlot*> stats_slots;
+static uint64_t retired_stats[NUM_OF_STATS];
+/* The sums at the last reset, which are subtracted from the current sums. */
+static uint64_t stats_baseline[NUM_OF_STATS];
+
+static thread_local StatsSlot stats;
+
+StatsSlot::StatsSlot()
+{
+	for(auto& counter : counters)
+		counter.store(0, std::memory_order_relaxed);
+
+	pthread_mutex_lock(&stats_lock);
+	stats_slots.push_back(this);
+	pthread_mutex_unlock(&stats_lock);
+}
+
+StatsSlot::~StatsSlot()
+{
+	pthread_mutex_lock(&stats_lock);
+	for(int i = 0; i < NUM_OF_STATS; ++i)
+		retired_stats[i] += counters[i].load(std::memory_order_relaxed);
+	stats_slots.erase(std::remove(stats_slots.begin(), stats_slots.end(), this), stats_slots.end());
+	pthread_mutex_unlock(&stats_lock);
+}
+
+static inline void count(stat_type type, uint64_t n = 1)
+{
+	auto& counter = stats.counters[type];
+	counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+static uint64_t elapsedNanoseconds(const timespec& start)
+{
+	timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start.tv_sec) * 1000000000ull + end.tv_nsec - start.tv_nsec;
+}
+
+/*
+ *  Acquire the latches, and count the time only when they had to wait.
+ *  An uncontended acquisition costs no more than the try.
+ */
+static void lockPartition(latch* lock)
+{
+	if(pthread_mutex_trylock(lock) == 0)
+		return;
+
+	timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pthread_mutex_lock(lock);
+	count(PARTITION_LATCH_WAITS);
+	count(PARTITION_LATCH_WAIT_NS, elapsedNanoseconds(start));
+}
+
+static void lockFrame(rw_latch* lock, lock_mode mode)
+{
+	if((mode == EXCLUSIVE ? pthread_rwlock_trywrlock(lock) : pthread_rwlock_tryrdlock(lock)) == 0)
+		return;
+
+	timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if(mode == EXCLUSIVE)
+		pthread_rwlock_wrlock(lock);
+	else
+		pthread_rwlock_rdlock(lock);
+	count(FRAME_LATCH_WAITS);
+	count(FRAME_LATCH_WAIT_NS, elapsedNanoseconds(start));
+}
+
+/* The pin count of a claimed block, low enough to stay negative under any number of pins */
+static constexpr int CLAIMED = -(1 << 30);
+
+// Buffer Block
+
+BufferBlock::BufferBlock(int table_id, pagenum_t pgnum)
+	:frame(nullptr), table_id(table_id), pgnum(pgnum), dirty(false), pin_cnt(0), next(nullptr), prev(nullptr),
+	referenced(false), queue(0), lock(PTHREAD_RWLOCK_INITIALIZER), version(0), owner(nullptr),
+	retired(false), swip(0), index_page(false)
+{
+
+}
+
+Page& BufferBlock::getPage()
+{
+	return *frame;
+}
+
+// Buffer Partition
+
+BufferPartition::BufferPartition()
+	:blocks(), retired(), policy(nullptr), directory(), lock(PTHREAD_MUTEX_INITIALIZER), num_pin_waiters(0),
+	num_index_frames(0)
+{
+	// The timeout of a pin wait is not affected by the changes of the system clock.
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&unpinned, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+BufferPartition::~BufferPartition()
+{
+	// The blocks themselves belong to the frame descriptors of the buffer manager.
+	for ( auto block : blocks )
+		BufferManager::flush_frame(block);
+	blocks.clear();
+	retired.clear();
+
+	delete policy;
+	policy = nullptr;
+	pthread_cond_destroy(&unpinned);
+}
+
+/*
+ *  Take the given buffer blocks and hand them to the replacement policy.
+ */
+int BufferPartition::init(BufferBlock* first, int buf_num, policy_type type)
+{
+	if(buf_num <= 0)
+		return -1;
+
+	pthread_mutex_lock(&lock);
+
+	policy = ReplacementPolicy::create(type);
+	directory.clear();
+	directory.reserve(buf_num);
+
+	pthread_mutex_unlock(&lock);
+
+	grow(first, buf_num);
+	return SUCCESS;
+}
+
+/*
+ *  Add the given buffer blocks to this partition.
+ */
+void BufferPartition::grow(BufferBlock* first, int buf_num)
+{
+	pthread_mutex_lock(&lock);
+
+	blocks.reserve(blocks.size() + buf_num);
+	for(BufferBlock* temp = first; temp != first + buf_num; ++temp){
+		temp->owner = this;
+
+		// Assign the buffer frames into the buffer partition.
+		blocks.push_back(temp);
+		policy->add(temp);
+	}
+	directory.reserve(blocks.size());
+
+	// The waiters may take the new blocks.
+	pthread_cond_broadcast(&unpinned);
+	pthread_mutex_unlock(&lock);
+}
+
+/*
+ *  Bring back up to n retired blocks to the partition.
+ *  Their frames were given back to the OS, and are zero-filled again on the first touch.
+ */
+int BufferPartition::revive(size_t n)
+{
+	size_t num_revived = 0;
+
+	pthread_mutex_lock(&lock);
+
+	while(num_revived < n && !retired.empty()){
+		BufferBlock* p = retired.back();
+		retired.pop_back();
+
+		p->retired = false;
+		blocks.push_back(p);
+		policy->add(p);
+		++num_revived;
+	}
+
+	if(num_revived)
+		pthread_cond_broadcast(&unpinned);
+	pthread_mutex_unlock(&lock);
+	return static_cast<int>(num_revived);
+}
+
+/*
+ *  Retire up to n unpinned blocks from the cold end, keeping MIN_SIZE_OF_PARTITION blocks.
+ *  The clean blocks go first, and the dirty ones are written back before they are retired.
+ *  The partition goes on serving the other requests between the blocks.
+ */
+int BufferPartition::shrink(size_t n)
+{
+	std::vector<BufferBlock*> victims;
+
+	// Write back the cold blocks first, so that few writes are left for the partition latch.
+	clean(n);
+
+	for(size_t i = 0; i < n; ++i){
+		pthread_mutex_lock(&lock);
+
+		// The index region goes last.
+		BufferBlock* p = NULL;
+		VictimFilter leaves = { 0, HIGH_PRIORITY, false, false, true };
+		if(blocks.size() - victims.size() > MIN_SIZE_OF_PARTITION){
+			if((p = policy->victim(true, &leaves)) == NULL && (p = policy->victim(false, &leaves)) == NULL
+				&& (p = policy->victim(true)) == NULL)
+				p = policy->victim();
+		}
+		if(p == NULL){
+			pthread_mutex_unlock(&lock);
+			break;
+		}
+		if(!claim(p)){
+			// Pinned by a lock-free hit in the meantime
+			pthread_mutex_unlock(&lock);
+			continue;
+		}
+
+		// If the page is dirty,
+		BufferManager::writeBack(p);
+		if(p->table_id)
+			policy->evict(p);
+		resetFrame(p);
+		policy->remove(p);
+		p->retired = true;
+		victims.push_back(p);
+		release(p, 0);
+
+		pthread_mutex_unlock(&lock);
+	}
+
+	pthread_mutex_lock(&lock);
+
+	blocks.erase(std::remove_if(blocks.begin(), blocks.end(), [](BufferBlock* p){ return p->retired; }), blocks.end());
+	retired.insert(retired.end(), victims.begin(), victims.end());
+
+	pthread_mutex_unlock(&lock);
+
+	// Give the memory of the frames back to the OS. (No one revives them until the resize is over.)
+	for(auto p : victims)
+		madvise(p->frame, PAGESIZE, MADV_DONTNEED);
+
+	return static_cast<int>(victims.size());
+}
+
+BufferBlock* BufferPartition::get_frame(int table_id, pagenum_t pagenum, bool may_write_back, bool* unread)
+{
+	const uint64_t key = BufferManager::makeKey(table_id, pagenum);
+	BufferBlock* resident = NULL;
+	BufferBlock* p = NULL;
+	bool waiting = false, timed_out = false;
+	timespec start, deadline;
+
+	// A resident hit takes no latch, but a single pin.
+	if((resident = directory.find(key)) != NULL && tryPin(resident, table_id, pagenum)){
+		count(HITS);
+		return resident;
+	}
+	resident = NULL;
+
+	lockPartition(&lock);
+
+	for(;;){
+		/*
+		 * If there is the requested page on the buffer, return it.
+		 * (It may have been read by another request while waiting.)
+		 */
+		if((resident = directory.find(key)) != NULL)
+			break;
+
+		/* Find an unpinned frame that can be used for replacement, preferably a clean one. */
+		/* (A lock-free hit may pin it before it is claimed.) */
+		if((p = chooseVictim(table_id, may_write_back)) != NULL){
+			if(claim(p))
+				break;
+			continue;
+		}
+		if(!may_write_back || timed_out)
+			break;
+
+		/*
+		 * Every frame is pinned, so wait until one is unpinned.
+		 * The waiter is registered before searching again, so that an unpin
+		 * which doesn't take the partition latch either is seen by the search or wakes it up.
+		 */
+		if(!waiting){
+			waiting = true;
+			++num_pin_waiters;
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			deadline.tv_sec = start.tv_sec + PIN_WAIT_TIMEOUT_MS / 1000;
+			deadline.tv_nsec = start.tv_nsec + (PIN_WAIT_TIMEOUT_MS % 1000) * 1000000L;
+			if(deadline.tv_nsec >= 1000000000L){
+				++deadline.tv_sec;
+				deadline.tv_nsec -= 1000000000L;
+			}
+			continue;
+		}
+		timed_out = pthread_cond_timedwait(&unpinned, &lock, &deadline) == ETIMEDOUT;
+	}
+
+	if(waiting){
+		--num_pin_waiters;
+		count(PIN_WAITS);
+		count(PIN_WAIT_NS, elapsedNanoseconds(start));
+	}
+
+	if(resident != NULL){
+		/* Pinned */
+		++resident->pin_cnt;
+
+		pthread_mutex_unlock(&lock);
+		count(HITS);
+		return resident;
+	}
+
+	if(p == NULL){
+		pthread_mutex_unlock(&lock);
+		// No frames can be evicted. (The read-ahead gives up at once.)
+		if(may_write_back)
+			count(PIN_TIMEOUTS);
+		return NULL;
+	}
+
+	// Evict
+	// A claimed block is latched and pinned by nobody, so it can be replaced without its latch.
+	// The odd version turns the optimistic readers of the old page away.
+	++p->version;
+
+	// If the page is dirty,
+	// (under the partition latch, so that a miss on the old page can't read it before it is written)
+	BufferManager::writeBack(p);
+
+	// Refill the page metadata
+	if(p->table_id){
+		policy->evict(p);
+		directory.erase(BufferManager::makeKey(p->table_id, p->pgnum));
+		BufferManager::countFrame(p->table_id, -1);
+		count(EVICTIONS);
+		if(p->index_page)
+			count(INDEX_EVICTIONS);
+	}
+	BufferManager::countFrame(table_id, 1);
+	p->table_id = table_id;
+	p->pgnum = pagenum;
+	directory.insert(key, p);
+	policy->load(p);
+
+	// The frame is latched in EXCLUSIVE mode before it is published, and read without the partition latch,
+	// so the misses of a partition are read at once, and a request for the same page waits on the frame latch.
+	// (Nobody else holds the latch of a claimed block.)
+	pthread_rwlock_wrlock(&p->lock);
+
+	/* Pinned */
+	release(p, 1);
+
+	pthread_mutex_unlock(&lock);
+	// Only the read-ahead doesn't write back.
+	count(may_write_back ? MISSES : PREFETCHES);
+
+	if(unread != NULL){
+		*unread = true;
+		return p;
+	}
+
+	// Read the page
+	file_read_page(p->table_id, p->pgnum, *p->frame);
+	finishRead(p);
+	return p;
+}
+
+void BufferPartition::finishRead(BufferBlock* block)
+{
+	classify(block, block->pgnum == HEADER_PAGE_NUM || !block->frame->isLeaf());
+	++block->version;
+	pthread_rwlock_unlock(&block->lock);
+}
+
+/*
+ *  Choose a block to be replaced for the given table.
+ *  - A clean block is preferred to a dirty one, which needs a synchronous write.
+ *  - If any table has a quota, a block which honors the quotas is searched for first,
+ *    from the lowest priority class up.
+ *  - The quotas are soft: if there is no such block, any unpinned block is chosen
+ *    rather than failing the request. A read-ahead (!may_write_back) is given up instead.
+ *  - The index region is spared while it takes up no more than INDEX_REGION_PERCENT of the partition.
+ *    Its blocks are replaced only when every other block is pinned, and never by a read-ahead.
+ */
+BufferBlock* BufferPartition::chooseVictim(int table_id, bool may_write_back)
+{
+	BufferBlock* p = NULL;
+	const bool spare = num_index_frames * 100 <= static_cast<int>(blocks.size()) * INDEX_REGION_PERCENT;
+
+	if(BufferManager::quotas_enabled){
+		VictimFilter filter = { table_id, LOW_PRIORITY, false, true, spare };
+		if(IS_VALID_TID(table_id)){
+			const auto& quota = BufferManager::quotas[table_id];
+			filter.only_own_table = quota.max_frames > 0 && quota.occupancy >= quota.max_frames;
+		}
+
+		if((p = filteredVictim(filter, true)) != NULL || !may_write_back)
+			return p;
+		if((p = filteredVictim(filter, false)) != NULL){
+			BufferManager::wakeCleaner();
+			return p;
+		}
+	}
+
+	VictimFilter filter = { table_id, HIGH_PRIORITY, false, false, spare };
+	if((p = policy->victim(true, &filter)) == NULL && may_write_back){
+		// Every replaceable block is dirty, so the page cleaner is behind.
+		BufferManager::wakeCleaner();
+		if((p = policy->victim(false, &filter)) == NULL && spare){
+			// Under extreme pressure, the index region gives up a block as well.
+			if((p = policy->victim(true)) == NULL)
+				p = policy->victim();
+		}
+	}
+	return p;
+}
+
+void BufferPartition::classify(BufferBlock* block, bool index_page)
+{
+	if(block->index_page.exchange(index_page, std::memory_order_relaxed) != index_page)
+		num_index_frames.fetch_add(index_page ? 1 : -1, std::memory_order_relaxed);
+}
+
+BufferBlock* BufferPartition::filteredVictim(VictimFilter& filter, bool clean_only)
+{
+	BufferBlock* p = NULL;
+
+	for(int priority = LOW_PRIORITY; priority <= HIGH_PRIORITY && p == NULL; ++priority){
+		filter.max_priority = static_cast<buffer_priority>(priority);
+		p = policy->victim(clean_only, &filter);
+	}
+	return p;
+}
+
+void BufferPartition::put_frame(BufferBlock* src)
+{
+	// The hit path of a latch-free policy doesn't touch the partition at all.
+	if(policy->isLatchFree()){
+		policy->access(src);
+		unpin(src);
+		return;
+	}
+
+	lockPartition(&lock);
+
+	policy->access(src);
+
+	/* Unpinned */
+	if(--src->pin_cnt == 0 && num_pin_waiters > 0)
+		pthread_cond_signal(&unpinned);
+
+	pthread_mutex_unlock(&lock);
+}
+
+bool BufferPartition::tryPin(BufferBlock* block, int table_id, pagenum_t pagenum)
+{
+	if(block->pin_cnt.fetch_add(1) < 0){
+		// Being replaced
+		block->pin_cnt.fetch_sub(1);
+		return false;
+	}
+
+	// The pin keeps the page in the block from now on.
+	if(block->table_id == table_id && block->pgnum == pagenum)
+		return true;
+
+	unpin(block);
+	return false;
+}
+
+bool BufferPartition::claim(BufferBlock* block)
+{
+	int unpinned = 0;
+	return block->pin_cnt.compare_exchange_strong(unpinned, CLAIMED);
+}
+
+void BufferPartition::release(BufferBlock* block, int pins)
+{
+	// Keep the pins which have been tried on the claimed block.
+	block->pin_cnt.fetch_add(pins - CLAIMED);
+}
+
+void BufferPartition::unpin(BufferBlock* block)
+{
+	/* Unpinned */
+	if(--block->pin_cnt > 0 || num_pin_waiters == 0)
+		return;
+
+	// The waiter holds the partition latch until it sleeps, so the signal is not lost.
+	pthread_mutex_lock(&lock);
+	pthread_cond_signal(&unpinned);
+	pthread_mutex_unlock(&lock);
+}
+
+// The dirty blocks have been written back by the buffer manager already.
+// A block pinned at the moment (by the page cleaner, for one) is waited for, so that no block keeps the table.
+void BufferPartition::close_table(int table_id)
+{
+	pthread_mutex_lock(&lock);
+
+	// The waiter is registered before searching, as in get_frame().
+	++num_pin_waiters;
+	for(;;){
+		bool pinned = false;
+		for(auto p : blocks){
+			if(p->table_id && p->table_id == table_id){
+				if(!claim(p)){
+					pinned = true;
+					continue;
+				}
+				// If the page is dirty,
+				BufferManager::writeBack(p);
+				resetFrame(p);
+				release(p, 0);
+			}
+		}
+		if(!pinned)
+			break;
+
+		// An unpin wakes up a single waiter, so it looks again after a while even if another one has been woken up.
+		timespec deadline;
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		deadline.tv_nsec += CLOSE_PIN_POLL_MS * 1000000L;
+		deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+		deadline.tv_nsec %= 1000000000L;
+		if(pthread_cond_timedwait(&unpinned, &lock, &deadline) == 0 && num_pin_waiters > 1)
+			// The unpin may have been meant for a request waiting for a victim, so it is passed on.
+			pthread_cond_signal(&unpinned);
+	}
+	--num_pin_waiters;
+
+	pthread_mutex_unlock(&lock);
+}
+
+// The caller holds the frame in EXCLUSIVE mode.
+void BufferPartition::close_frame(BufferBlock* frame)
+{
+	pthread_mutex_lock(&lock);
+
+	// Flush the buffer
+	BufferManager::writeBack(frame);
+
+	// Reset the information of the buffer block
+	resetFrame(frame);
+
+	pthread_mutex_unlock(&lock);
+}
+
+// Pinned blocks are not replaced while being written.
+void BufferPartition::collectDirty(int table_id, std::vector<DirtyPage>& dest)
+{
+	pthread_mutex_lock(&lock);
+
+	for(auto p : blocks){
+		if(p->table_id && (table_id == 0 || p->table_id == table_id) && p->dirty){
+			++p->pin_cnt;
+			dest.push_back({ p, p->table_id, p->pgnum });
+		}
+	}
+
+	pthread_mutex_unlock(&lock);
+}
+
+bool BufferPartition::pinDirty(const DirtyPage& page)
+{
+	pthread_mutex_lock(&lock);
+
+	BufferBlock* p = page.block;
+	const bool held = p->table_id == page.table_id && p->pgnum == page.pgnum && p->dirty;
+	if(held)
+		++p->pin_cnt;
+
+	pthread_mutex_unlock(&lock);
+	return held;
+}
+
+// The replacement policy lists the blocks from the coldest one.
+void BufferPartition::collectResident(int table_id, std::vector<DirtyPage>& dest)
+{
+	std::vector<BufferBlock*> resident;
+
+	pthread_mutex_lock(&lock);
+
+	policy->coldest(resident, blocks.size());
+	for(auto it = resident.rbegin(); it != resident.rend(); ++it){
+		BufferBlock* p = *it;
+		if(p->table_id && (table_id == 0 || p->table_id == table_id))
+			dest.push_back({ p, p->table_id, p->pgnum });
+	}
+
+	pthread_mutex_unlock(&lock);
+}
+
+int BufferPartition::clean(size_t n)
+{
+	std::vector<BufferBlock*> candidates;
+	size_t num_candidates = 0;
+	int num_cleaned = 0;
+
+	pthread_mutex_lock(&lock);
+
+	// Pin the dirty, unpinned blocks so that they are not replaced while being written.
+	policy->coldest(candidates, n);
+	for(auto p : candidates){
+		if(p->pin_cnt == 0 && p->dirty){
+			++p->pin_cnt;
+			candidates[num_candidates++] = p;
+		}
+	}
+	candidates.resize(num_candidates);
+
+	pthread_mutex_unlock(&lock);
+
+	for(auto p : candidates){
+		// Leave it if someone is modifying it in the meantime.
+		if(pthread_rwlock_tryrdlock(&p->lock) == 0){
+			if(p->dirty){
+				BufferManager::writeBack(p);
+				++num_cleaned;
+			}
+
+			pthread_rwlock_unlock(&p->lock);
+		}
+
+		unpin(p);
+	}
+
+	return num_cleaned;
+}
+
+// It must be protected by the partition latch at the caller method, and the frame must be owned by the caller.
+void BufferPartition::resetFrame(BufferBlock* frame)
+{
+	if(frame->table_id){
+		directory.erase(BufferManager::makeKey(frame->table_id, frame->pgnum));
+		BufferManager::countFrame(frame->table_id, -1);
+	}
+
+	// The version is odd while the frame is changed, so that an optimistic reader of the old page
+	// fails its validation. If the caller holds the frame in EXCLUSIVE mode, it is odd already,
+	// and it is made even when the caller releases the frame.
+	const bool latched = frame->version.load(std::memory_order_relaxed) & 1;
+	if(latched)
+		frame->version += 2;
+	else
+		frame->version.fetch_add(1, std::memory_order_acq_rel);
+
+	frame->frame->clear();
+	frame->table_id = 0;
+	frame->pgnum = 0;
+	frame->dirty = false;
+	classify(frame, false);
+
+	if(!latched)
+		frame->version.fetch_add(1, std::memory_order_release);
+}
+
+// Buffer Management
+
+bool BufferManager::initialized = false;
+BufferPartition* BufferManager::partitions = nullptr;
+int BufferManager::num_partitions = 0;
+std::vector<BufferManager::FrameChunk> BufferManager::chunks;
+frame_backing BufferManager::backing = TRANSPARENT_HUGE_PAGES;
+latch BufferManager::resize_lock = PTHREAD_MUTEX_INITIALIZER;
+BufferManager::TableQuota BufferManager::quotas[DEFAULT_SIZE_OF_TABLES + 1];
+std::atomic<bool> BufferManager::quotas_enabled(false);
+uint64_t BufferManager::generation = 0;
+std::atomic<bool> BufferManager::swizzling(false);
+BufferBlock* BufferManager::swizzle_chunks[MAX_SWIZZLE_CHUNKS];
+thread BufferManager::cleaner;
+bool BufferManager::cleaner_running = false;
+latch BufferManager::cleaner_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t BufferManager::cleaner_cond = PTHREAD_COND_INITIALIZER;
+std::atomic<int> BufferManager::num_dirty(0);
+int BufferManager::dirty_high_water = 0;
+int BufferManager::dirty_high_water_percent = DEFAULT_DIRTY_HIGH_WATER;
+int BufferManager::num_blocks = 0;
+std::atomic<int> BufferManager::writes_in_flight[DEFAULT_SIZE_OF_TABLES + 1];
+std::atomic<bool> BufferManager::tracking_updates[DEFAULT_SIZE_OF_TABLES + 1];
+std::vector<DirtyPage> BufferManager::updated_pages[DEFAULT_SIZE_OF_TABLES + 1];
+thread BufferManager::prefetcher;
+bool BufferManager::prefetcher_running = false;
+latch BufferManager::prefetch_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t BufferManager::prefetch_cond = PTHREAD_COND_INITIALIZER;
+std::deque<BufferManager::PrefetchRequest> BufferManager::prefetch_queue;
+int BufferManager::prefetching_table_id = 0;
+pthread_cond_t BufferManager::prefetch_done_cond = PTHREAD_COND_INITIALIZER;
+
+/*
+ *  Sequential scan detection (per thread)
+ *  - next: the right sibling of the leaf page put back last.
+ *  - streak: the number of consecutive accesses which followed the leaf chain.
+ *  - ahead: the number of pages expected to be read ahead of the scan.
+ */
+static thread_local struct
+{
+	int table_id;
+	pagenum_t next;
+	int streak;
+	int ahead;
+} scan = { 0, HEADER_PAGE_NUM, 0, 0 };
+
+/*
+ *  Frame hints (per thread)
+ *  The buffer blocks found last by the optimistic reads, so that the hot pages
+ *  such as the root are found without the partition latch.
+ */
+static thread_local struct
+{
+	BufferBlock* block;
+	uint64_t generation;
+} hints[NUM_OF_FRAME_HINTS];
+
+/*
+ *  Initialize the buffer pool with the given number.
+ *
+ *  - The buffer blocks are evenly distributed into the partitions.
+ *  - Every partition uses its own instance of the given replacement policy.
+ *  - Each partition has at least MIN_SIZE_OF_PARTITION blocks,
+ *    so the number of partitions may be reduced for a small pool.
+ *  - If success, return 0.
+ *  - Otherwise, return non-zero value.
+ */
+int BufferManager::init(int buf_num, int num_partitions, policy_type policy, frame_backing backing){
+	if(buf_num <= 0)
+		return -1;
+
+	if(initialized)
+		return -1;
+
+	if(num_partitions <= 0)
+		num_partitions = DEFAULT_NUM_OF_PARTITIONS;
+	if(num_partitions > buf_num / MIN_SIZE_OF_PARTITION)
+		num_partitions = buf_num / MIN_SIZE_OF_PARTITION;
+	if(num_partitions < 1)
+		num_partitions = 1;
+
+	BufferManager::backing = backing;
+	BufferBlock* descriptors = allocateFrames(buf_num);
+	if(descriptors == nullptr)
+		return -1;
+
+	BufferManager::num_partitions = num_partitions;
+	partitions = new BufferPartition[num_partitions];
+
+	for(int i = 0, first = 0; i < num_partitions; ++i){
+		// Spread the remainder over the first partitions.
+		int size = buf_num / num_partitions + (i < buf_num % num_partitions);
+		if(partitions[i].init(descriptors + first, size, policy) != SUCCESS){
+			delete[] partitions;
+			partitions = nullptr;
+			BufferManager::num_partitions = 0;
+			releaseFrames();
+			return -1;
+		}
+		first += size;
+	}
+
+	num_blocks = buf_num;
+	num_dirty = 0;
+	for(auto& quota : quotas)
+		quota.occupancy = 0;
+	++generation;
+	set_dirty_high_water(DEFAULT_DIRTY_HIGH_WATER);
+
+	// Initialization is finished.
+	initialized = true;
+
+	// Start the page cleaner.
+	cleaner_running = true;
+	if(pthread_create(&cleaner, NULL, BufferManager::runCleaner, NULL) != 0)
+		cleaner_running = false;
+
+	// Start the prefetcher.
+	prefetcher_running = true;
+	if(pthread_create(&prefetcher, NULL, BufferManager::runPrefetcher, NULL) != 0)
+		prefetcher_running = false;
+
+	return SUCCESS;
+}
+
+/*
+ *  Map an aligned, contiguous region for the page frames.
+ *  - EXPLICIT_HUGE_PAGES: try the reserved huge pages first (falls back to the others).
+ *  - TRANSPARENT_HUGE_PAGES: ask the kernel to back the region with huge pages when it can.
+ *  - NORMAL_PAGES: plain pages.
+ */
+byte* BufferManager::allocateArena(size_t size, frame_backing backing)
+{
+	void* region = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+	if(backing == EXPLICIT_HUGE_PAGES)
+		region = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+
+	if(region == MAP_FAILED){
+		// mmap returns a page-aligned region, which is aligned to PAGESIZE as well.
+		region = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(region == MAP_FAILED)
+			return nullptr;
+
+#ifdef MADV_HUGEPAGE
+		if(backing != NORMAL_PAGES)
+			madvise(region, size, MADV_HUGEPAGE);
+#endif
+	}
+
+	return static_cast<byte*>(region);
+}
+
+/*
+ *  Allocate a new frame chunk.
+ *  The page frames are laid out in the arena and their descriptors in a separate array.
+ */
+BufferBlock* BufferManager::allocateFrames(int buf_num)
+{
+	FrameChunk chunk;
+
+	chunk.arena_size = static_cast<size_t>(buf_num) * PAGESIZE;
+	if((chunk.arena = allocateArena(chunk.arena_size, backing)) == nullptr)
+		return nullptr;
+
+	chunk.descriptors = new BufferBlock[buf_num];
+	for(int i = 0; i < buf_num; ++i)
+		chunk.descriptors[i].frame = new (chunk.arena + static_cast<size_t>(i) * PAGESIZE) Page();
+
+	// The blocks which don't fit in a swizzled child offset are never swizzled.
+	const uint64_t chunk_number = chunks.size();
+	if(chunk_number < MAX_SWIZZLE_CHUNKS && buf_num <= MAX_SWIZZLE_SLOTS){
+		for(int i = 0; i < buf_num; ++i)
+			chunk.descriptors[i].swip = SWIZZLED_BIT | chunk_number << SWIZZLE_CHUNK_SHIFT | static_cast<uint64_t>(i) << SWIZZLE_SLOT_SHIFT;
+		swizzle_chunks[chunk_number] = chunk.descriptors;
+	}
+
+	chunks.push_back(chunk);
+	return chunk.descriptors;
+}
+
+void BufferManager::countFrame(int table_id, int delta)
+{
+	if(IS_VALID_TID(table_id))
+		quotas[table_id].occupancy.fetch_add(delta, std::memory_order_relaxed);
+}
+
+/*
+ *  Whether the block may be replaced for the table of the filter.
+ *  - A table at its maximum only replaces its own blocks.
+ *  - Otherwise, an empty block may always be replaced.
+ *  - The blocks of a table above the priority class of the filter are kept.
+ *  - The blocks of another table which holds no more than its minimum are kept.
+ */
+bool BufferManager::honorsQuota(const BufferBlock* block, const VictimFilter& filter)
+{
+	const int table_id = block->table_id;
+	if(filter.only_own_table)
+		return table_id == filter.table_id;
+
+	if(!IS_VALID_TID(table_id))
+		return true;
+
+	const TableQuota& quota = quotas[table_id];
+	if(quota.priority > filter.max_priority)
+		return false;
+
+	return table_id == filter.table_id || quota.occupancy > quota.min_frames;
+}
+
+BufferPartition& BufferManager::partitionOf(int table_id, pagenum_t pgnum)
+{
+	// Fibonacci hashing so that neighboring pages fall into different partitions.
+	uint64_t hash = makeKey(table_id, pgnum) * 0x9E3779B97F4A7C15ull;
+	return partitions[(hash >> 32) % num_partitions];
+}
+
+/*
+ *  Get the buffer control block from the buffer pool,
+ *  latched in the given mode. (SHARED for reading, EXCLUSIVE for writing)
+ *  The frame latch is acquired after the partition latch is released,
+ *  so waiting for a writer of one page never blocks the other pages of the partition.
+ */
+BufferBlock* BufferManager::get_frame(int table_id, pagenum_t pagenum, lock_mode mode) {
+	if(!initialized)
+		return NULL;
+
+	// Check whether the caller is following a leaf chain.
+	if(table_id == scan.table_id && pagenum == scan.next){
+		++scan.streak;
+		--scan.ahead;
+	}else{
+		scan.streak = 0;
+		scan.ahead = 0;
+	}
+
+	BufferBlock* block = partitionOf(table_id, pagenum).get_frame(table_id, pagenum);
+	if(block == NULL)
+		return NULL;
+
+	// The pin keeps the block from being replaced while waiting for the latch.
+	lockFrame(&block->lock, mode);
+	if(mode == EXCLUSIVE)
+		++block->version;
+
+	return block;
+}
+
+/*
+ *  Release the latch and put the buffer block back to the buffer pool.
+ */
+void BufferManager::put_frame(BufferBlock* src) {
+	if(!initialized)
+		return;
+
+	if(src == NULL)
+		return;
+
+	// Remember where a leaf chain goes next, and read ahead once a scan is detected.
+	if(src->pgnum != HEADER_PAGE_NUM && src->frame->isLeaf()){
+		offset_t sibling = src->frame->getOffset(DEFAULT_LEAF_ORDER - 1);
+
+		scan.table_id = src->table_id;
+		scan.next = PGNUM(sibling);
+
+		if(sibling != HEADER_PAGE_OFFSET
+			&& scan.streak >= SEQUENTIAL_SCAN_THRESHOLD
+			&& scan.ahead <= DEFAULT_PREFETCH_DEPTH / 2){
+			prefetch(scan.table_id, scan.next);
+			scan.ahead = DEFAULT_PREFETCH_DEPTH;
+		}
+	}
+
+	// Only an exclusive holder makes the version odd, since a pinned block is never replaced.
+	// The page may have turned into another type of node in the meantime. (e.g. a new page)
+	if(src->version & 1){
+		src->owner->classify(src, src->table_id && (src->pgnum == HEADER_PAGE_NUM || !src->frame->isLeaf()));
+		++src->version;
+	}
+	pthread_rwlock_unlock(&src->lock);
+
+	src->owner->put_frame(src);
+}
+
+/*
+ *  Get the buffer control block for an optimistic read, neither pinned nor latched.
+ *  - The block is found through the frame hints of the thread, or the page directory. (without the latch)
+ *  - The frames are never freed while the pool is alive,
+ *    so reading a block replaced in the meantime is safe, and is caught by validate().
+ *  - Return NULL if the page is not in the buffer pool or is being modified.
+ */
+BufferBlock* BufferManager::get_frame_optimistic(int table_id, pagenum_t pagenum, uint64_t& version)
+{
+	if(!initialized)
+		return NULL;
+
+	const uint64_t key = makeKey(table_id, pagenum);
+	auto& hint = hints[(key * 0x9E3779B97F4A7C15ull) >> 32 & (NUM_OF_FRAME_HINTS - 1)];
+
+	BufferBlock* block = hint.generation == generation ? hint.block : NULL;
+	if(block == NULL || block->table_id != table_id || block->pgnum != pagenum){
+		if((block = partitionOf(table_id, pagenum).directory.find(key)) == NULL)
+			return NULL;
+		hint.block = block;
+		hint.generation = generation;
+	}
+
+	version = block->version.load(std::memory_order_acquire);
+	if(version & 1)
+		return NULL;
+
+	// The block may have been replaced before the version was read.
+	if(block->table_id != table_id || block->pgnum != pagenum)
+		return NULL;
+
+	count(HITS);
+	return block;
+}
+
+/*
+ *  Check that the page has not been modified or replaced since get_frame_optimistic().
+ */
+bool BufferManager::validate(BufferBlock* block, uint64_t version)
+{
+	// The reads of the page must not be reordered after the version check.
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return block->version.load(std::memory_order_relaxed) == version;
+}
+
+/*
+ *  Get the buffer control block which a swizzled child offset points at.
+ *  - The frame descriptors are never freed while the pool is alive, so the block is always there,
+ *    but it may hold another page by now, which is checked like get_frame_optimistic().
+ */
+BufferBlock* BufferManager::get_frame_swizzled(int table_id, offset_t entry, uint64_t& version)
+{
+	if(!initialized)
+		return NULL;
+
+	BufferBlock* descriptors = swizzle_chunks[entry >> SWIZZLE_CHUNK_SHIFT & (MAX_SWIZZLE_CHUNKS - 1)];
+	if(descriptors == NULL)
+		return NULL;
+
+	BufferBlock* block = descriptors + (entry >> SWIZZLE_SLOT_SHIFT & (MAX_SWIZZLE_SLOTS - 1));
+	version = block->version.load(std::memory_order_acquire);
+	if(version & 1)
+		return NULL;
+
+	if(block->table_id != table_id || block->pgnum != (entry & SWIZZLE_PGNUM_MASK))
+		return NULL;
+
+	count(HITS);
+	return block;
+}
+
+/*
+ *  Point the child entry at the block which holds the child page.
+ *  - The parent is pinned and latched in SHARED mode without waiting, which keeps its writers away,
+ *    and the unchanged version tells that the entry is still at the index.
+ *  - Only the form of the entry changes, so the page doesn't get dirty,
+ *    and the optimistic readers see either form of it.
+ *  - The entry still names the page, so an entry left behind by a replaced child is caught
+ *    by get_frame_swizzled(), and pointed at the new block by the next descent.
+ */
+void BufferManager::swizzle(int table_id, const ChildEntry& from, BufferBlock* child, pagenum_t pgnum)
+{
+	if(!swizzling.load(std::memory_order_relaxed) || child->swip == 0 || pgnum > SWIZZLE_PGNUM_MASK)
+		return;
+
+	const offset_t entry = child->swip | pgnum;
+	BufferBlock* parent = from.parent;
+	if(from.entry == entry || !parent->owner->tryPin(parent, table_id, from.parent_pgnum))
+		return;
+
+	if(pthread_rwlock_tryrdlock(&parent->lock) == 0){
+		if(parent->version.load(std::memory_order_acquire) == from.version)
+			parent->frame->swizzleChildEntry(from.index, from.entry, entry);
+		pthread_rwlock_unlock(&parent->lock);
+	}
+
+	parent->owner->unpin(parent);
+}
+
+void BufferManager::set_swizzling(bool enable)
+{
+	swizzling = enable;
+}
+
+/*
+ *  Hint that the leaf chain starting from the given page is going to be scanned.
+ *  Up to depth pages of the chain are read into the buffer pool in the background.
+ */
+void BufferManager::prefetch(int table_id, pagenum_t pagenum, int depth){
+	if(!initialized || !prefetcher_running)
+		return;
+
+	if(pagenum == HEADER_PAGE_NUM || depth <= 0)
+		return;
+
+	if(depth > MAX_PREFETCH_DEPTH)
+		depth = MAX_PREFETCH_DEPTH;
+
+	pthread_mutex_lock(&prefetch_lock);
+
+	// Read-ahead is only a hint, so drop it if the prefetcher is far behind.
+	if(prefetch_queue.size() < MAX_PREFETCH_REQUESTS){
+		prefetch_queue.push_back({ table_id, pagenum, depth });
+		pthread_cond_signal(&prefetch_cond);
+	}
+
+	pthread_mutex_unlock(&prefetch_lock);
+}
+
+/*
+ *  Get the page and set whether this block gets dirty.
+ */
+Page* BufferManager::get_page(BufferBlock* block, bool dirty){
+	if ( !block )
+		return nullptr;
+
+	// The exclusive latch of the caller keeps the writers of this block out.
+	if(dirty && !block->dirty.exchange(true)){
+		// Wake up the page cleaner when the number of dirty blocks crosses the high-water mark.
+		if(++num_dirty == dirty_high_water + 1)
+			BufferManager::wakeCleaner();
+
+		// The update in progress writes back the blocks it has dirtied. (A block replaced until then has been written.)
+		if(tracking_updates[block->table_id].load(std::memory_order_relaxed))
+			updated_pages[block->table_id].push_back({ block, block->table_id, block->pgnum });
+	}
+
+	return block->frame;
+}
+
+/*
+	 *  Request the allocatioin of a page to the disk manager
+	 *  and return the number of the new page.
+	 */
+pagenum_t BufferManager::buf_alloc_page(int table_id, pagenum_t near)
+{
+	return file_alloc_page(table_id, near);
+}
+
+/*
+ *  Request the unused page to be free to the disk manager.
+ */
+void BufferManager::buf_free_page(int table_id, pagenum_t page_to_be_free)
+{
+	file_free_page(table_id, page_to_be_free);
+}
+
+/*
+ *  Save the resident pages of the table (every open table if 0) as its working set.
+ *  The partitions are merged in turn so that the hottest pages of each stay in front.
+ */
+void BufferManager::saveWorkingSet(int table_id)
+{
+	std::vector<std::vector<DirtyPage>> resident(num_partitions);
+	size_t longest = 0;
+	for(int i = 0; i < num_partitions; ++i){
+		partitions[i].collectResident(table_id, resident[i]);
+		longest = std::max(longest, resident[i].size());
+	}
+
+	std::vector<pagenum_t> pages[DEFAULT_SIZE_OF_TABLES + 1];
+	for(size_t k = 0; k < longest; ++k){
+		for(int i = 0; i < num_partitions; ++i){
+			if(k < resident[i].size())
+				pages[resident[i][k].table_id].push_back(resident[i][k].pgnum);
+		}
+	}
+
+	for(int tid = 1; tid <= DEFAULT_SIZE_OF_TABLES; ++tid){
+		if(table_id == 0 || tid == table_id)
+			file_save_working_set(tid, pages[tid]);
+	}
+}
+
+/*
+ *  Read the working set saved when the table was closed last time into the buffer pool.
+ *  The hottest pages which fit in the pool are read in the order of the page numbers,
+ *  replacing clean blocks only, like a read-ahead.
+ */
+void BufferManager::warm_up(int table_id)
+{
+	if(!initialized)
+		return;
+
+	std::vector<pagenum_t> pages = file_load_working_set(table_id);
+	if(pages.size() > static_cast<size_t>(num_blocks))
+		pages.resize(num_blocks);
+	std::sort(pages.begin(), pages.end());
+
+	// The reads are in flight at once, and each block is published as its read completes.
+	for(auto pgnum : pages){
+		bool unread = false;
+		BufferBlock* block = partitionOf(table_id, pgnum).get_frame(table_id, pgnum, false, &unread);
+		if(block == NULL)
+			break;
+
+		if(unread)
+			file_read_page_async(table_id, pgnum, *block->frame, completeRead, block);
+		else
+			block->owner->put_frame(block);
+	}
+	file_wait_io();
+}
+
+/*
+ *  Flush the buffers of the given table and clear them.
+ *  The resident pages are saved as the working set of the table.
+ */
+void BufferManager::close_table(int table_id){
+	if(!initialized)
+		return;
+
+	// Cancel the read-ahead of the table, and wait for the one in progress.
+	pthread_mutex_lock(&prefetch_lock);
+	for(auto it = prefetch_queue.begin(); it != prefetch_queue.end();){
+		if(it->table_id == table_id)
+			it = prefetch_queue.erase(it);
+		else
+			++it;
+	}
+	while(prefetching_table_id == table_id)
+		pthread_cond_wait(&prefetch_done_cond, &prefetch_lock);
+	pthread_mutex_unlock(&prefetch_lock);
+
+	// Write back the table in a batch first, and then clear the blocks.
+	flush_table(table_id);
+	saveWorkingSet(table_id);
+	for(int i = 0; i < num_partitions; ++i)
+		partitions[i].close_table(table_id);
+}
+
+/*
+ *  Flush the specific buffer and clear it.
+ */
+void BufferManager::close_frame(BufferBlock* frame){
+	if(!initialized)
+		return;
+
+	if(frame == NULL)
+		return;
+
+	frame->owner->close_frame(frame);
+}
+
+/*
+ *  Flush the buffers of the given table.
+ */
+void BufferManager::flush_table(int table_id){
+	if(!initialized)
+		return;
+
+	if(table_id == 0)
+		return;
+
+	// The consecutive pages of a table are spread over the partitions, so they are collected from all of them.
+	std::vector<DirtyPage> pages;
+	for(int i = 0; i < num_partitions; ++i)
+		partitions[i].collectDirty(table_id, pages);
+
+	writeBackBatch(pages);
+
+	// A page made clean by someone else may not be written yet.
+	while(writes_in_flight[table_id].load(std::memory_order_acquire) > 0)
+		sched_yield();
+}
+
+/*
+ *  Record the blocks of the table which get dirty from now on.
+ */
+void BufferManager::track_updates(int table_id){
+	if(!initialized || table_id == 0)
+		return;
+
+	tracking_updates[table_id].store(true, std::memory_order_relaxed);
+}
+
+/*
+ *  Flush the buffers dirtied since track_updates(), without looking through the pool.
+ *  A block freed, replaced or written back by someone else in the meantime is skipped.
+ */
+void BufferManager::flush_updates(int table_id){
+	if(!initialized || table_id == 0)
+		return;
+
+	tracking_updates[table_id].store(false, std::memory_order_relaxed);
+
+	// The blocks which still hold the pages are pinned, so that they are not replaced while being written.
+	std::vector<DirtyPage> pages;
+	for(const auto& page : updated_pages[table_id]){
+		if(page.block->owner->pinDirty(page))
+			pages.push_back(page);
+	}
+	updated_pages[table_id].clear();
+	writeBackBatch(pages);
+
+	// A page made clean by someone else may not be written yet.
+	while(writes_in_flight[table_id].load(std::memory_order_acquire) > 0)
+		sched_yield();
+}
+
+/*
+ *  Flush the specific buffer.
+ */
+void BufferManager::flush_frame(BufferBlock* frame){
+	if(!initialized)
+		return;
+
+	if(frame == NULL)
+		return;
+
+	pthread_rwlock_rdlock(&frame->lock);
+
+	BufferManager::writeBack(frame);
+
+	pthread_rwlock_unlock(&frame->lock);
+}
+
+// The frame must be latched, or unpinned under the partition latch at the caller method.
+/*
+ *  The image of the frame to be written to the disk.
+ *  A swizzled child offset never reaches the disk, so a node page is written from a copy
+ *  with its child offsets unswizzled. (The entries may be swizzled while it is written.)
+ */
+const Page* BufferManager::diskImage(const BufferBlock* frame, Page& copy)
+{
+	if(frame->pgnum == HEADER_PAGE_NUM || frame->frame->isLeaf())
+		return frame->frame;
+
+	frame->frame->copyUnswizzled(copy);
+	return std::addressof(copy);
+}
+
+void BufferManager::writeBack(BufferBlock* frame)
+{
+	// The write-back is in flight from before the page is made clean until it is written. (see flush_table())
+	auto& in_flight = writes_in_flight[frame->table_id];
+	++in_flight;
+
+	// Several readers may try to write back at once, and only one of them does.
+	if(frame->dirty.exchange(false)){
+		Page copy;
+		file_write_page(frame->table_id, frame->pgnum, *diskImage(frame, copy));
+		--num_dirty;
+		count(WRITE_BACKS);
+	}
+
+	in_flight.fetch_sub(1, std::memory_order_release);
+}
+
+/*
+ *  Write back the pinned dirty pages in the order of (table id, page number).
+ *
+ *  - A run of consecutive pages goes out in one vectored write of up to MAX_WRITE_BATCH pages.
+ *  - The pages of a run are latched in SHARED mode until its write completes,
+ *    but a latch is only waited for when no other latch is held, so that it never deadlocks with a writer.
+ *    (The runs in flight are waited for first.)
+ *  - A page which is clean by now, or has been cleared in the meantime, ends the run.
+ *  - Each table gets a single durability barrier after its last run.
+ */
+void BufferManager::writeBackBatch(std::vector<DirtyPage>& pages)
+{
+	std::sort(pages.begin(), pages.end(), [](const DirtyPage& a, const DirtyPage& b){
+		return a.table_id != b.table_id ? a.table_id < b.table_id : a.pgnum < b.pgnum;
+	});
+
+	std::unique_ptr<WriteRun> run(new WriteRun);
+	int run_table_id = 0;
+	pagenum_t run_first = 0;
+
+	// Submit the write of the run, which is released when it completes.
+	auto writeRun = [&](){
+		if(run->blocks.empty())
+			return;
+
+		WriteRun* submitted = run.release();
+		run.reset(new WriteRun);
+		file_write_pages_async(run_table_id, run_first, submitted->frames.data(),
+			static_cast<int>(submitted->frames.size()), completeWrite, submitted);
+	};
+
+	for(size_t i = 0; i < pages.size(); ++i){
+		const DirtyPage& page = pages[i];
+		BufferBlock* p = page.block;
+
+		const bool continues = !run->blocks.empty() && page.table_id == run_table_id
+			&& page.pgnum == run_first + run->blocks.size() && run->blocks.size() < MAX_WRITE_BATCH;
+		if(!continues)
+			writeRun();
+
+		// The latch is waited for only after the runs in flight, which hold their latches, have completed.
+		if(pthread_rwlock_tryrdlock(&p->lock) != 0){
+			writeRun();
+			file_wait_io();
+			lockFrame(&p->lock, SHARED);
+		}
+
+		++writes_in_flight[page.table_id];
+		if(p->table_id != page.table_id || p->pgnum != page.pgnum || !p->dirty.exchange(false)){
+			--writes_in_flight[page.table_id];
+			pthread_rwlock_unlock(&p->lock);
+		}else{
+			if(run->blocks.empty()){
+				run_table_id = page.table_id;
+				run_first = page.pgnum;
+			}
+
+			// Only a node page needs a copy.
+			run->copies.emplace_back();
+			const Page* image = diskImage(p, run->copies.back());
+			if(image != std::addressof(run->copies.back()))
+				run->copies.pop_back();
+
+			run->frames.push_back(image);
+			run->blocks.push_back(p);
+		}
+
+		// A durability barrier after the last page of the table
+		if(i + 1 == pages.size() || pages[i + 1].table_id != page.table_id){
+			writeRun();
+			file_wait_io();
+			file_sync(page.table_id);
+		}
+	}
+
+	for(auto& page : pages)
+		page.block->owner->unpin(page.block);
+}
+
+void BufferManager::completeRead(void* arg, int64_t result)
+{
+	BufferBlock* block = static_cast<BufferBlock*>(arg);
+
+	if(result < 0){
+		errno = static_cast<int>(-result);
+		perror("completeRead error");
+	}
+
+	block->owner->finishRead(block);
+	block->owner->put_frame(block);
+}
+
+void BufferManager::completeWrite(void* arg, int64_t result)
+{
+	std::unique_ptr<WriteRun> run(static_cast<WriteRun*>(arg));
+
+	// A regular file is written in full unless the disk is full.
+	if(result != static_cast<int64_t>(OFFSET(run->blocks.size()))){
+		errno = result < 0 ? static_cast<int>(-result) : ENOSPC;
+		perror("completeWrite error");
+	}
+
+	num_dirty -= static_cast<int>(run->blocks.size());
+	count(WRITE_BACKS, run->blocks.size());
+	writes_in_flight[run->blocks.front()->table_id].fetch_sub(static_cast<int>(run->blocks.size()), std::memory_order_release);
+
+	for(auto p : run->blocks)
+		pthread_rwlock_unlock(&p->lock);
+}
+
+/*
+ *  The page cleaner writes back the dirty blocks from the cold end of every partition,
+ *  so that a miss can almost always replace a clean block without a synchronous write.
+ *  It sweeps a small part of the partitions periodically, and a half of them
+ *  while the number of dirty blocks is above the high-water mark.
+ */
+void* BufferManager::runCleaner(void*)
+{
+	// Set when a sweep has found nothing to write back: the dirty blocks are all hot, out of its reach.
+	bool stalled = false;
+
+	pthread_mutex_lock(&cleaner_lock);
+	while(cleaner_running){
+		if(num_dirty <= dirty_high_water || stalled){
+			timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			deadline.tv_nsec += CLEANER_INTERVAL_MS * 1000000L;
+			deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+			deadline.tv_nsec %= 1000000000L;
+			pthread_cond_timedwait(&cleaner_cond, &cleaner_lock, &deadline);
+		}
+		if(!cleaner_running)
+			break;
+		pthread_mutex_unlock(&cleaner_lock);
+
+		const bool under_pressure = num_dirty > dirty_high_water;
+		int num_cleaned = 0;
+		for(int i = 0; i < num_partitions; ++i){
+			// A resize may change the blocks of the partition in the meantime.
+			pthread_mutex_lock(&partitions[i].lock);
+			const size_t size = partitions[i].blocks.size();
+			pthread_mutex_unlock(&partitions[i].lock);
+			num_cleaned += partitions[i].clean(under_pressure ? size / 2 : size / 8 + 1);
+		}
+		stalled = num_cleaned == 0;
+
+		pthread_mutex_lock(&cleaner_lock);
+	}
+	pthread_mutex_unlock(&cleaner_lock);
+	return NULL;
+}
+
+void* BufferManager::runPrefetcher(void*)
+{
+	pthread_mutex_lock(&prefetch_lock);
+	while(prefetcher_running){
+		if(prefetch_queue.empty()){
+			pthread_cond_wait(&prefetch_cond, &prefetch_lock);
+			continue;
+		}
+
+		PrefetchRequest request = prefetch_queue.front();
+		prefetch_queue.pop_front();
+		prefetching_table_id = request.table_id;
+		pthread_mutex_unlock(&prefetch_lock);
+
+		readAhead(request);
+
+		pthread_mutex_lock(&prefetch_lock);
+		prefetching_table_id = 0;
+		pthread_cond_broadcast(&prefetch_done_cond);
+	}
+	pthread_mutex_unlock(&prefetch_lock);
+	return NULL;
+}
+
+/*
+ *  Read the leaf chain from the given page into the buffer pool.
+ *  Only clean blocks are replaced, so the prefetcher never waits on a write,
+ *  and it stops as soon as a partition has no clean block to spare.
+ */
+void BufferManager::readAhead(const PrefetchRequest& request)
+{
+	pagenum_t pgnum = request.pgnum;
+
+	for(int i = 0; i < request.depth && pgnum != HEADER_PAGE_NUM; ++i){
+		BufferBlock* block = partitionOf(request.table_id, pgnum).get_frame(request.table_id, pgnum, false);
+		if(block == NULL)
+			break;
+
+		pthread_rwlock_rdlock(&block->lock);
+
+		const Page& page = *block->frame;
+		pgnum = page.isLeaf() ? PGNUM(page.getOffset(DEFAULT_LEAF_ORDER - 1)) : HEADER_PAGE_NUM;
+
+		pthread_rwlock_unlock(&block->lock);
+
+		block->owner->put_frame(block);
+	}
+}
+
+void BufferManager::wakeCleaner()
+{
+	pthread_mutex_lock(&cleaner_lock);
+	pthread_cond_signal(&cleaner_cond);
+	pthread_mutex_unlock(&cleaner_lock);
+}
+
+/*
+ *  Set the percentage of dirty blocks in the buffer pool
+ *  above which the page cleaner works without a pause.
+ */
+void BufferManager::set_dirty_high_water(int percent)
+{
+	if(percent < 0)
+		percent = 0;
+	if(percent > 100)
+		percent = 100;
+	dirty_high_water_percent = percent;
+	dirty_high_water = num_blocks * percent / 100;
+}
+
+/*
+ *  Set the buffer quota of the table.
+ *  - If success, return 0.
+ *  - Otherwise, return non-zero value.
+ */
+int BufferManager::set_table_quota(int table_id, int min_frames, int max_frames, buffer_priority priority)
+{
+	if(!IS_VALID_TID(table_id))
+		return -1;
+
+	if(min_frames < 0 || max_frames < 0 || (max_frames > 0 && max_frames < min_frames))
+		return -1;
+
+	if(priority < LOW_PRIORITY || priority > HIGH_PRIORITY)
+		return -1;
+
+	quotas[table_id].min_frames = min_frames;
+	quotas[table_id].max_frames = max_frames;
+	quotas[table_id].priority = priority;
+	quotas_enabled = true;
+	return SUCCESS;
+}
+
+/*
+ *  Return the number of frames which hold the pages of the table.
+ */
+int BufferManager::get_table_occupancy(int table_id)
+{
+	if(!IS_VALID_TID(table_id))
+		return 0;
+
+	return quotas[table_id].occupancy.load(std::memory_order_relaxed);
+}
+
+/*
+ *  Sum up the statistics of every thread since the last reset.
+ *  A thread may be counting in the meantime, so the sum is not a snapshot of one moment.
+ */
+void BufferManager::get_stats(buffer_stats& result)
+{
+	uint64_t sums[NUM_OF_STATS];
+
+	pthread_mutex_lock(&stats_lock);
+	for(int i = 0; i < NUM_OF_STATS; ++i){
+		sums[i] = retired_stats[i] - stats_baseline[i];
+		for(auto slot : stats_slots)
+			sums[i] += slot->counters[i].load(std::memory_order_relaxed);
+	}
+	pthread_mutex_unlock(&stats_lock);
+
+	result.hits = sums[HITS];
+	result.misses = sums[MISSES];
+	result.prefetches = sums[PREFETCHES];
+	result.evictions = sums[EVICTIONS];
+	result.index_evictions = sums[INDEX_EVICTIONS];
+	result.write_backs = sums[WRITE_BACKS];
+	result.pin_waits = sums[PIN_WAITS];
+	result.pin_wait_ns = sums[PIN_WAIT_NS];
+	result.pin_timeouts = sums[PIN_TIMEOUTS];
+	result.partition_latch_waits = sums[PARTITION_LATCH_WAITS];
+	result.partition_latch_wait_ns = sums[PARTITION_LATCH_WAIT_NS];
+	result.frame_latch_waits = sums[FRAME_LATCH_WAITS];
+	result.frame_latch_wait_ns = sums[FRAME_LATCH_WAIT_NS];
+}
+
+/*
+ *  Start the statistics over from zero.
+ *  The slots are written by their own threads only, so the current sums are kept as a baseline instead.
+ */
+void BufferManager::reset_stats(void)
+{
+	pthread_mutex_lock(&stats_lock);
+	for(int i = 0; i < NUM_OF_STATS; ++i){
+		stats_baseline[i] = retired_stats[i];
+		for(auto slot : stats_slots)
+			stats_baseline[i] += slot->counters[i].load(std::memory_order_relaxed);
+	}
+	pthread_mutex_unlock(&stats_lock);
+}
+
+void BufferManager::print_stats(std::ostream& os)
+{
+	buffer_stats summary;
+	get_stats(summary);
+
+	const uint64_t requests = summary.hits + summary.misses;
+	os << "[Buffer Pool Statistics]\n"
+		<< "Hit Ratio : " << (requests ? 100.0 * summary.hits / requests : 0.0) << "%"
+		<< " (" << summary.hits << " hits, " << summary.misses << " misses)\n"
+		<< "Prefetches : " << summary.prefetches << "\n"
+		<< "Evictions : " << summary.evictions << " (" << summary.index_evictions << " index pages)\n"
+		<< "Write Backs : " << summary.write_backs << "\n"
+		<< "Pin Waits : " << summary.pin_waits
+		<< " (" << summary.pin_wait_ns << "ns, " << summary.pin_timeouts << " timeouts)\n"
+		<< "Partition Latch Waits : " << summary.partition_latch_waits
+		<< " (" << summary.partition_latch_wait_ns << "ns)\n"
+		<< "Frame Latch Waits : " << summary.frame_latch_waits
+		<< " (" << summary.frame_latch_wait_ns << "ns)" << std::endl;
+}
+
+/*
+ *  Grow or shrink the buffer pool to the given number of blocks online.
+ *
+ *  - The number of partitions doesn't change, so no page moves to another partition.
+ *  - Every partition is resized on its own, and keeps serving the requests in the meantime.
+ *  - A grow brings back the retired blocks first, and allocates a new frame chunk for the rest.
+ *  - A shrink retires unpinned blocks only, so it may stop short of the given size.
+ *  - If the pool reaches the given size, return 0.
+ *  - Otherwise, return non-zero value.
+ */
+int BufferManager::resize(int buf_num)
+{
+	if(!initialized)
+		return -1;
+
+	if(buf_num < num_partitions * MIN_SIZE_OF_PARTITION)
+		return -1;
+
+	pthread_mutex_lock(&resize_lock);
+
+	std::vector<int> missing(num_partitions, 0);
+	int num_missing = 0;
+
+	for(int i = 0; i < num_partitions; ++i){
+		const int size = static_cast<int>(partitions[i].blocks.size());
+		const int target = buf_num / num_partitions + (i < buf_num % num_partitions);
+
+		if(target > size){
+			missing[i] = target - size - partitions[i].revive(target - size);
+			num_missing += missing[i];
+		}else if(target < size){
+			partitions[i].shrink(size - target);
+		}
+	}
+
+	if(num_missing > 0){
+		BufferBlock* first = allocateFrames(num_missing);
+		for(int i = 0; first != nullptr && i < num_partitions; ++i){
+			partitions[i].grow(first, missing[i]);
+			first += missing[i];
+		}
+	}
+
+	num_blocks = 0;
+	for(int i = 0; i < num_partitions; ++i)
+		num_blocks += static_cast<int>(partitions[i].blocks.size());
+	set_dirty_high_water(dirty_high_water_percent);
+
+	const int result = num_blocks == buf_num ? SUCCESS : -1;
+
+	pthread_mutex_unlock(&resize_lock);
+	return result;
+}
+
+/*
+ *  Flush all buffers in the buffer pool and free the pool.
+ */
+void BufferManager::shutdown(void)
+{
+	if(!initialized)
+		return;
+
+	// Stop the page cleaner.
+	if(cleaner_running){
+		pthread_mutex_lock(&cleaner_lock);
+		cleaner_running = false;
+		pthread_cond_signal(&cleaner_cond);
+		pthread_mutex_unlock(&cleaner_lock);
+		pthread_join(cleaner, NULL);
+	}
+
+	// Stop the prefetcher.
+	if(prefetcher_running){
+		pthread_mutex_lock(&prefetch_lock);
+		prefetcher_running = false;
+		prefetch_queue.clear();
+		pthread_cond_signal(&prefetch_cond);
+		pthread_mutex_unlock(&prefetch_lock);
+		pthread_join(prefetcher, NULL);
+	}
+
+	// Write back every table in a batch, and then every partition flushes what is left when it is destroyed.
+	std::vector<DirtyPage> pages;
+	for(int i = 0; i < num_partitions; ++i)
+		partitions[i].collectDirty(0, pages);
+	writeBackBatch(pages);
+	saveWorkingSet(0);
+
+	delete[] partitions;
+	partitions = nullptr;
+	num_partitions = 0;
+
+	// Make every table durable, including what the page cleaner has written.
+	for(int table_id = 1; table_id <= DEFAULT_SIZE_OF_TABLES; ++table_id)
+		file_sync(table_id);
+
+	releaseFrames();
+
+	// The quotas are set for the tables of this pool only.
+	for(auto& quota : quotas){
+		quota.min_frames = 0;
+		quota.max_frames = 0;
+		quota.priority = NORMAL_PRIORITY;
+		quota.occupancy = 0;
+	}
+	quotas_enabled = false;
+
+	initialized = false;
+}
+
+/*
+ *  Release the frame descriptors and the frame arenas.
+ */
+void BufferManager::releaseFrames(void)
+{
+	for(auto& chunk : chunks){
+		delete[] chunk.descriptors;
+		munmap(chunk.arena, chunk.arena_size);
+	}
+	chunks.clear();
+	std::fill(std::begin(swizzle_chunks), std::end(swizzle_chunks), nullptr);
+}
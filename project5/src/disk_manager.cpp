@@ -1,210 +1,788 @@
-#include "disk_manager.h"
-
-#include "wrapper_funcs.h"
-#include "buffer_manager.h"
-#include "macros.h"
-
-#include <cstdio> /* perror */
-#include <cstdlib> /* atexit */
-#include <fcntl.h> /* file control */
-#include <unistd.h> /* open, close, lseek */
-#include <sys/stat.h> /* system constants */
-
-#define READ(tid, buf) (read(fds[(tid)-1], (buf), PAGESIZE))
-#define WRITE(tid, buf) (write(fds[(tid)-1], (buf), PAGESIZE))
-#define CLOSE(tid) (close(fds[tid-1]))
-#define SEEK(tid, offset) (lseek(fds[(tid)-1], (offset), SEEK_SET) >= 0)
-#define FD(tid) *(&fds[(tid)-1])
-#define NUM_COL(tid) *(&num_cols[(tid)-1])
-#define IS_TID_OPEN(tid) (fds[(tid)-1] != 0)
-
-/*
- * For automatic DB shutdown
- */
-static bool initialized = false;
-
-/*
- * File Descriptor for R/W
- */
-static int fds[DEFAULT_SIZE_OF_TABLES];
-static int num_cols[DEFAULT_SIZE_OF_TABLES];
-
-/*
- *  Read an on-disk page into the in-memory page structure(dest)
- */
-void file_read_page(int table_id, pagenum_t pagenum, Page& dest){
-	if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)))
-        return;
-
-	SEEK(table_id, OFFSET(pagenum));
-	READ(table_id, &dest);
-}
-
-/*
- *  Write an in-memory page(src) to the on-disk page
- */
-void file_write_page(int table_id, pagenum_t pagenum, const Page& src){
-	if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)))
-        return;
-
-	SEEK(table_id, OFFSET(pagenum));
-	WRITE(table_id, &src);
-    fsync(FD(table_id));
-}
-
-/*
- *  Allocate an on-disk page from the free page list
- */
-pagenum_t file_alloc_page(int table_id) {
-    if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)))
-        return INVALID_TID;
-
-	/*
-     * Only if a file doesn't have enough free pages,
-     * add free pages into the free page list
-     * with an amount of DEFAULT_SIZE_OF_FREE_PAGES.
-     */
-
-    /* Update the cached header page. */
-    auto buf_header = BufferManager::get_frame(table_id, HEADER_PAGE_NUM);
-    auto header = BufferManager::get_page(buf_header, true);
-
-    if ( header->getFreePageOffset() == HEADER_PAGE_OFFSET) {
-        Page buf;
-		buf.clear();
-		
-		pagenum_t next_free_page_num = header->getNumOfPages();
-
-		header->setFreePageOffset(OFFSET(next_free_page_num));
-        for ( int i = 1; i <= DEFAULT_SIZE_OF_FREE_PAGES; ++i, ++next_free_page_num) {
-            buf.setNextFreePageOffset(i != DEFAULT_SIZE_OF_FREE_PAGES ? OFFSET(next_free_page_num + 1) : HEADER_PAGE_OFFSET);
-            file_write_page(table_id, next_free_page_num, buf);
-        }
-
-        // Set Number of Pages
-		header->setNumOfPages(header->getNumOfPages() + DEFAULT_SIZE_OF_FREE_PAGES);
-    }
-
-    // Get a free page offset from header page.
-    offset_t free_page_offset = header->getFreePageOffset();
-
-    // Read the free page.
-    auto buf_free_pg = BufferManager::get_frame(table_id, PGNUM(free_page_offset));
-	assert(buf_free_pg != nullptr);
-    auto free_page = BufferManager::get_page(buf_free_pg, false);
-
-    // Get a next free page offset from the free page.
-	header->setFreePageOffset(free_page->getNextFreePageOffset());
-    
-    BufferManager::put_frame(buf_free_pg);
-    BufferManager::put_frame(buf_header);
-    return free_page_offset;
-}
-
-/*
- *  Free an on-disk page to the free page list
- */
-void file_free_page(int table_id, pagenum_t pagenum) {
-	if ( !(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)) )
-		return;
-
-	// Read the page to remove and the header page.
-	auto buf_header = BufferManager::get_frame(table_id, HEADER_PAGE_NUM);
-	auto buf_free_pg = BufferManager::get_frame(table_id, pagenum);
-
-	auto header = BufferManager::get_page(buf_header, true);
-	auto free_page = BufferManager::get_page(buf_free_pg, true);
-
-	// Clear
-	free_page->clear();
-
-	// Add it into the free page list
-	free_page->setNextFreePageOffset(header->getFreePageOffset());
-	header->setFreePageOffset(OFFSET(pagenum));
-
-	// Apply changes to the header page.
-	BufferManager::put_frame(buf_header);
-
-	// Free it
-	BufferManager::close_frame(buf_free_pg);
-	BufferManager::put_frame(buf_free_pg);
-}
-
-/*
- * Open existing data file using ‘pathname’ or create one if not existed.
- * If success, return table_id.
- */
-int file_open_table(char * pathname, int num_column){
-	if (pathname == NULL)
-        return INVALID_FILENAME;
-
-    // Find an empty slot for file descriptor.
-    int tid = 1;
-    
-    while( IS_TID_OPEN(tid) )
-        tid++;
-
-    if(tid > DEFAULT_SIZE_OF_TABLES)    
-        return FULL_FD; // FD slots are full.
-
-    // Make a file if it does not exist.
-    // Do not allow a symbolic link to open.
-    // Flush the buffer whenever try to write.
-    // Permission is set to 0644.
-    FD(tid) = open(
-        pathname,
-        O_CREAT | O_RDWR  | O_NOFOLLOW | O_SYNC, // Options
-        S_IRUSR | S_IWUSR | S_IRGRP    | S_IROTH // Permissions
-    );
-
-    if(!initialized){
-        // Add a handler to be executed before the process exits.
-        // atexit(BufferManager::shutdown);
-
-        initialized = true;
-    }
-
-    if ( FD(tid) == -1) {
-        perror("open_db error");
-        return INVALID_FD;
-    }
-
-    Page header;
-
-    // Read the header from the file
-    if (READ(tid, &header) == 0) {
-        // If the header page doesn't exist, create a new one.
-		header.clear();
-        header.setNumOfPages(1); // the number of created pages
-		header.setNumOfColumns(num_column); // the number of columns
-        fsync(FD(tid));
-        WRITE(tid, &header);        
-    }
-
-	NUM_COL(tid) = header.getNumOfColumns();
-
-    /* unique table id */
-    return tid;
-}
-
-/*
- * Write the pages relating to this table to disk and close the table.
- *  - Write all pages of this table from buffer to disk and discard the table id.
- *  - If success, return 0. Otherwise, return non-zero value.
- */
-int file_close_table(int table_id){
-    if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)))
-        return INVALID_TID;
-
-    // writes out the pages only from those relating to given table_id
-    BufferManager::close_table(table_id);    
-    CLOSE(table_id);
-	NUM_COL(table_id) = 0;
-    FD(table_id) = 0;
-	return SUCCESS;
-}
-
-int getNumOfCols(int table_id) noexcept
-{
-	return IS_VALID_TID(table_id) && IS_TID_OPEN(table_id) ? NUM_COL(table_id) : 0;
+#include "disk_manager.h"
+
+#include "wrapper_funcs.h"
+#include "buffer_manager.h"
+#include "io_ring.h"
+#include "macros.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio> /* perror */
+#include <cstdlib> /* atexit */
+#include <algorithm> /* remove_if */
+#include <string>
+#include <vector>
+#include <fcntl.h> /* file control, fallocate */
+#include <unistd.h> /* open, close, pread, pwrite, ftruncate */
+#include <sys/mman.h> /* mmap */
+#include <sys/stat.h> /* system constants */
+#include <sys/uio.h> /* pwritev */
+
+/*
+ * Positional I/O doesn't move the file offset shared by the threads,
+ * so the reads and writes of a table need no latch.
+ */
+#define READ(tid, buf, offset) (pread(fds[(tid)-1], (buf), PAGESIZE, (offset)))
+#define WRITE(tid, buf, offset) (pwrite(fds[(tid)-1], (buf), PAGESIZE, (offset)))
+#define CLOSE(tid) (close(fds[tid-1]))
+#define FD(tid) *(&fds[(tid)-1])
+#define NUM_COL(tid) *(&num_cols[(tid)-1])
+#define PATH(tid) (paths[(tid)-1])
+#define WARM_PATH(tid) (PATH(tid) + WARM_FILE_SUFFIX)
+#define IS_TID_OPEN(tid) (fds[(tid)-1] != 0)
+#define MODE(tid) (modes[(tid)-1])
+#define MAPPING(tid) (mappings[(tid)-1])
+#define DIRECT(tid) (direct[(tid)-1])
+#define EXTENT(tid) (extents[(tid)-1])
+#define FREE_PAGES(tid) (free_pages[(tid)-1])
+
+/*
+ * For automatic DB shutdown
+ */
+static bool initialized = false;
+
+/*
+ * File Descriptor for R/W
+ */
+static int fds[DEFAULT_SIZE_OF_TABLES];
+static int num_cols[DEFAULT_SIZE_OF_TABLES];
+static std::string paths[DEFAULT_SIZE_OF_TABLES];
+
+/*
+ * Durability mode per table, and the one for the tables to be opened
+ */
+static durability_mode modes[DEFAULT_SIZE_OF_TABLES];
+static durability_mode default_mode = FULL_SYNC;
+
+/*
+ * Whether the table is read and written with direct I/O, bypassing the OS page cache
+ */
+static bool direct[DEFAULT_SIZE_OF_TABLES];
+
+/*
+ * Extent at the end of the file: the pages [next, end) are preallocated but not handed out yet.
+ *  - They are tracked here instead of the free page list, so the header counts only the pages handed out,
+ *    and the rest of the file is taken back as the extent when the table is opened again.
+ *  - size: the number of pages added by the last growth, doubled at every growth up to MAX_SIZE_OF_FREE_PAGES.
+ *  - Guarded by the latch of the header page, like the free page list.
+ */
+static struct
+{
+	pagenum_t next;
+	pagenum_t end;
+	pagenum_t size;
+} extents[DEFAULT_SIZE_OF_TABLES];
+
+/*
+ * The number of free pages in the free space map of each range of the table, counted at the open
+ *  - Guarded by the latch of the header page.
+ */
+static std::vector<int> free_pages[DEFAULT_SIZE_OF_TABLES];
+
+/*
+ * Mapping of the tables opened in MEMORY_MAPPED mode
+ *  - MAX_MAPPED_TABLE_SIZE of address space is reserved at the open, and the file is mapped
+ *    read-only at its start. It is extended in place as the file grows, so a mapped page never moves.
+ *  - version: odd while the table is being updated, when the file may lag behind the buffer pool.
+ *  - The updates are serialized by the update latch.
+ */
+static struct
+{
+	byte* base;
+	std::atomic<size_t> length;
+	std::atomic<uint64_t> version;
+} mappings[DEFAULT_SIZE_OF_TABLES];
+static latch update_locks[DEFAULT_SIZE_OF_TABLES] = { PTHREAD_MUTEX_INITIALIZER };
+
+/*
+ * Backend of the asynchronous I/O
+ */
+static std::atomic<io_backend> backend(SYNC_IO);
+
+/*
+ * The ring of the calling thread, or nullptr for the synchronous path.
+ */
+static IoRing* ring(){
+	return backend == IO_URING ? IoRing::local() : nullptr;
+}
+
+/*
+ *  Turn the direct I/O of the table off after a transfer has been refused with EINVAL,
+ *  which the file system returns if it can't transfer the aligned pages directly.
+ *  Return true if the transfer should be tried again.
+ */
+static bool fall_back_from_direct_io(int table_id){
+	if(errno != EINVAL || !DIRECT(table_id))
+		return false;
+
+	const int flags = fcntl(FD(table_id), F_GETFL);
+	if(flags == -1 || fcntl(FD(table_id), F_SETFL, flags & ~O_DIRECT) == -1)
+		return false;
+
+	DIRECT(table_id) = false;
+	return true;
+}
+
+/*
+ *  Read an on-disk page into the in-memory page structure(dest)
+ */
+void file_read_page(int table_id, pagenum_t pagenum, Page& dest){
+	if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)))
+        return;
+
+	ssize_t result = READ(table_id, &dest, OFFSET(pagenum));
+	if(result < 0 && fall_back_from_direct_io(table_id))
+		result = READ(table_id, &dest, OFFSET(pagenum));
+	if(result < 0)
+		perror("file_read_page error");
+}
+
+/*
+ *  Write an in-memory page(src) to the on-disk page
+ */
+void file_write_page(int table_id, pagenum_t pagenum, const Page& src){
+	if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)))
+        return;
+
+	ssize_t result = WRITE(table_id, &src, OFFSET(pagenum));
+	if(result < 0 && fall_back_from_direct_io(table_id))
+		result = WRITE(table_id, &src, OFFSET(pagenum));
+	if(result != PAGESIZE)
+		perror("file_write_page error");
+	if(MODE(table_id) == FULL_SYNC)
+		fdatasync(FD(table_id));
+}
+
+/*
+ *  Write the in-memory pages(src) to the consecutive on-disk pages from pagenum
+ *  with a single vectored write, followed by a data sync if sync is set.
+ *  Return the number of bytes written, or -errno.
+ */
+static int64_t write_pages(int table_id, pagenum_t pagenum, const Page* const* src, int count, bool sync){
+	iovec iov[MAX_WRITE_BATCH];
+	int done = 0;
+
+	while(done < count){
+		const int n = count - done < MAX_WRITE_BATCH ? count - done : MAX_WRITE_BATCH;
+		for(int i = 0; i < n; ++i){
+			iov[i].iov_base = const_cast<void*>(&*src[done + i]);
+			iov[i].iov_len = PAGESIZE;
+		}
+
+		// A regular file is written in full unless the disk is full.
+		ssize_t written = pwritev(FD(table_id), iov, n, OFFSET(pagenum + done));
+		if(written < 0 && fall_back_from_direct_io(table_id))
+			written = pwritev(FD(table_id), iov, n, OFFSET(pagenum + done));
+		if(written != static_cast<ssize_t>(n) * PAGESIZE)
+			return written < 0 ? -errno : static_cast<int64_t>(OFFSET(done)) + written;
+		done += n;
+	}
+	if(sync && fdatasync(FD(table_id)) != 0)
+		return -errno;
+	return OFFSET(count);
+}
+
+void file_write_pages(int table_id, pagenum_t pagenum, const Page* const* src, int count){
+	if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)))
+        return;
+
+	if(write_pages(table_id, pagenum, src, count, MODE(table_id) == FULL_SYNC) != static_cast<int64_t>(OFFSET(count)))
+		perror("file_write_pages error");
+}
+
+/*
+ *  Read an on-disk page into dest asynchronously, and call done(arg, the number of bytes read or -errno).
+ *  Without a ring, the page is read at once.
+ */
+void file_read_page_async(int table_id, pagenum_t pagenum, Page& dest, io_callback done, void* arg){
+	if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id))){
+		done(arg, -EBADF);
+		return;
+	}
+
+	IoRing* io = ring();
+	if(io == nullptr){
+		ssize_t result = READ(table_id, &dest, OFFSET(pagenum));
+		if(result < 0 && fall_back_from_direct_io(table_id))
+			result = READ(table_id, &dest, OFFSET(pagenum));
+		done(arg, result < 0 ? -errno : result);
+		return;
+	}
+	io->read(FD(table_id), &dest, PAGESIZE, OFFSET(pagenum), done, arg);
+}
+
+/*
+ *  Write the in-memory pages(src) to the consecutive on-disk pages from pagenum asynchronously.
+ *  The write is not synced in any mode: the caller makes a batch of them durable with a single file_sync().
+ */
+void file_write_pages_async(int table_id, pagenum_t pagenum, const Page* const* src, int count, io_callback done, void* arg){
+	if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id))){
+		done(arg, -EBADF);
+		return;
+	}
+
+	IoRing* io = ring();
+	if(io == nullptr || count > MAX_WRITE_BATCH){
+		done(arg, write_pages(table_id, pagenum, src, count, false));
+		return;
+	}
+
+	std::vector<iovec> iov(count);
+	for(int i = 0; i < count; ++i){
+		iov[i].iov_base = const_cast<void*>(&*src[i]);
+		iov[i].iov_len = PAGESIZE;
+	}
+	io->writev(FD(table_id), std::move(iov), OFFSET(pagenum), false, done, arg);
+}
+
+/*
+ *  Wait for the asynchronous requests of this thread.
+ */
+void file_wait_io(int max_in_flight){
+	IoRing* io = IoRing::current();
+	if(io != nullptr)
+		io->wait(max_in_flight);
+}
+
+/*
+ *  Select the backend of the asynchronous I/O.
+ *  io_uring is tried on the calling thread, and each thread falls back on its own
+ *  if it can't set up its ring.
+ */
+io_backend file_set_io_backend(io_backend requested){
+	if(requested == IO_URING && IoRing::local() == nullptr)
+		requested = SYNC_IO;
+
+	backend = requested;
+	return requested;
+}
+
+/*
+ *  Make the pages written to the table durable, unless it is in NO_SYNC mode.
+ */
+void file_sync(int table_id){
+	if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)))
+        return;
+
+	if(MODE(table_id) != NO_SYNC)
+		fsync(FD(table_id));
+}
+
+/*
+ *  Write back the buffers of the table (every open table if 0) and make them durable.
+ *  The pages written back by the page cleaner in the meantime are made durable as well.
+ */
+int file_checkpoint(int table_id){
+	if(table_id == 0){
+		for(int tid = 1; tid <= DEFAULT_SIZE_OF_TABLES; ++tid){
+			if(IS_TID_OPEN(tid))
+				file_checkpoint(tid);
+		}
+		return SUCCESS;
+	}
+
+	if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)))
+        return INVALID_TID;
+
+	BufferManager::flush_table(table_id);
+	file_sync(table_id);
+	return SUCCESS;
+}
+
+/*
+ *  Set the durability mode of the table, or of every table from now on if table_id is 0.
+ *  A table which gets a stronger mode is made durable after the change,
+ *  which covers the writes done in the weaker mode before it.
+ */
+int file_set_durability(int table_id, durability_mode mode){
+	if(mode < FULL_SYNC || mode > NO_SYNC)
+		return INVALID_INDEX;
+
+	if(table_id == 0){
+		default_mode = mode;
+		for(int tid = 1; tid <= DEFAULT_SIZE_OF_TABLES; ++tid){
+			if(IS_TID_OPEN(tid))
+				file_set_durability(tid, mode);
+		}
+		return SUCCESS;
+	}
+
+	if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)))
+        return INVALID_TID;
+
+	const bool stronger = mode < MODE(table_id);
+	MODE(table_id) = mode;
+	if(stronger)
+		fsync(FD(table_id));
+	return SUCCESS;
+}
+
+/*
+ *  Map the pages added to the file since the mapping was extended last time.
+ */
+static void extend_mapping(int table_id){
+	struct stat st;
+	if(fstat(FD(table_id), &st) != 0)
+		return;
+
+	const size_t length = MAPPING(table_id).length.load(std::memory_order_relaxed);
+	size_t size = static_cast<size_t>(st.st_size) / PAGESIZE * PAGESIZE;
+	if(size > MAX_MAPPED_TABLE_SIZE)
+		size = MAX_MAPPED_TABLE_SIZE;
+	if(size <= length)
+		return;
+
+	if(mmap(MAPPING(table_id).base + length, size - length, PROT_READ, MAP_SHARED | MAP_FIXED, FD(table_id), length) == MAP_FAILED){
+		perror("extend_mapping error");
+		return;
+	}
+	MAPPING(table_id).length.store(size, std::memory_order_release);
+}
+
+/*
+ *  Reserve the address space of the table and map the file into it.
+ *  If it fails, the table is read through the buffer pool only.
+ */
+static void map_table(int table_id){
+	void* base = mmap(NULL, MAX_MAPPED_TABLE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if(base == MAP_FAILED){
+		perror("map_table error");
+		return;
+	}
+
+	MAPPING(table_id).base = static_cast<byte*>(base);
+	MAPPING(table_id).length.store(0, std::memory_order_relaxed);
+	extend_mapping(table_id);
+}
+
+static void unmap_table(int table_id){
+	if(MAPPING(table_id).base == nullptr)
+		return;
+
+	munmap(MAPPING(table_id).base, MAX_MAPPED_TABLE_SIZE);
+	MAPPING(table_id).base = nullptr;
+	MAPPING(table_id).length.store(0, std::memory_order_relaxed);
+}
+
+/*
+ *  Start reading the mapping of the table: return false if the table is not mapped or is being updated,
+ *  and the caller reads it through the buffer pool.
+ */
+bool file_map_begin(int table_id, uint64_t& version){
+	if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)) || MAPPING(table_id).base == nullptr)
+		return false;
+
+	version = MAPPING(table_id).version.load(std::memory_order_acquire);
+	return !(version & 1);
+}
+
+/*
+ *  Check that the table has not been updated since file_map_begin().
+ */
+bool file_map_validate(int table_id, uint64_t version){
+	// The reads of the pages must not be reordered after the version check.
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return MAPPING(table_id).version.load(std::memory_order_relaxed) == version;
+}
+
+/*
+ *  Return the mapped page, or nullptr if it is beyond the mapping.
+ */
+const Page* file_mapped_page(int table_id, pagenum_t pagenum){
+	if(OFFSET(pagenum) >= MAPPING(table_id).length.load(std::memory_order_acquire))
+		return nullptr;
+
+	return reinterpret_cast<const Page*>(MAPPING(table_id).base + OFFSET(pagenum));
+}
+
+/*
+ *  Start an update of the table, which turns the readers of the mapping to the buffer pool.
+ */
+void file_begin_update(int table_id){
+	if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)) || MAPPING(table_id).base == nullptr)
+		return;
+
+	pthread_mutex_lock(&update_locks[table_id - 1]);
+	MAPPING(table_id).version.fetch_add(1, std::memory_order_acq_rel);
+	BufferManager::track_updates(table_id);
+}
+
+/*
+ *  Finish the update of the table: the pages modified by it are written to the file,
+ *  and the readers come back to the mapping.
+ */
+void file_end_update(int table_id){
+	if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)) || MAPPING(table_id).base == nullptr)
+		return;
+
+	BufferManager::flush_updates(table_id);
+	extend_mapping(table_id);
+
+	MAPPING(table_id).version.fetch_add(1, std::memory_order_release);
+	pthread_mutex_unlock(&update_locks[table_id - 1]);
+}
+
+/*
+ *  Grow the file by the next extent, preallocating its blocks without writing them.
+ *  If the file system can't preallocate, the file is only extended, and reads zeros there all the same.
+ */
+static void grow_file(int table_id){
+	pagenum_t size = EXTENT(table_id).size * 2;
+	if(size < DEFAULT_SIZE_OF_FREE_PAGES)
+		size = DEFAULT_SIZE_OF_FREE_PAGES;
+	if(size > MAX_SIZE_OF_FREE_PAGES)
+		size = MAX_SIZE_OF_FREE_PAGES;
+
+	const off_t offset = OFFSET(EXTENT(table_id).end);
+	const off_t length = OFFSET(size);
+	int result = fallocate(FD(table_id), 0, offset, length);
+	if(result != 0 && errno == EOPNOTSUPP)
+		result = ftruncate(FD(table_id), offset + length);
+	// Even so, a page is added to the file when it is written.
+	if(result != 0)
+		perror("grow_file error");
+
+	EXTENT(table_id).end += size;
+	EXTENT(table_id).size = size;
+}
+
+/*
+ *  Take the first free page from the given page (or the last one before it) out of the free space map
+ *  of the range, unless it is farther than the limit. Return HEADER_PAGE_NUM if none is taken.
+ */
+static pagenum_t take_free_page(int table_id, const Page* header, int range, pagenum_t near, pagenum_t limit){
+	const pagenum_t first = static_cast<pagenum_t>(range) * PAGES_PER_FREE_MAP;
+
+	auto buf_map = BufferManager::get_frame(table_id, header->getFreeMapPage(range), EXCLUSIVE);
+	const int index = BufferManager::get_page(buf_map, false)->findFreeInMap(near - first);
+	assert(index >= 0);
+
+	const pagenum_t pagenum = first + index;
+	if((pagenum > near ? pagenum - near : near - pagenum) > limit){
+		BufferManager::put_frame(buf_map);
+		return HEADER_PAGE_NUM;
+	}
+
+	BufferManager::get_page(buf_map, true)->setFreeInMap(index, false);
+	--FREE_PAGES(table_id)[range];
+
+	BufferManager::put_frame(buf_map);
+	return pagenum;
+}
+
+/*
+ *  Allocate an on-disk page, as near to the given page as it can. (HEADER_PAGE_NUM for no preference)
+ *  1. The first free page after the given page in its range, unless the next page of the extent is nearer
+ *  2. The next page of the extent at the end of the file
+ *  3. A free page in any range, once the extent has run out
+ *  4. The first page of a new extent
+ *  The free page list of an older file is used up first.
+ */
+pagenum_t file_alloc_page(int table_id, pagenum_t near) {
+    if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)))
+        return INVALID_TID;
+
+    /* The header page latch guards the free space maps and the extent. */
+    auto buf_header = BufferManager::get_frame(table_id, HEADER_PAGE_NUM, EXCLUSIVE);
+    auto header = BufferManager::get_page(buf_header, false);
+
+    if ( header->getFreePageOffset() != HEADER_PAGE_OFFSET ) {
+        header = BufferManager::get_page(buf_header, true);
+
+        // Get a free page offset from header page.
+        offset_t free_page_offset = header->getFreePageOffset();
+
+        // Read the free page.
+        auto buf_free_pg = BufferManager::get_frame(table_id, PGNUM(free_page_offset), SHARED);
+        assert(buf_free_pg != nullptr);
+        auto free_page = BufferManager::get_page(buf_free_pg, false);
+
+        // Get a next free page offset from the free page.
+        header->setFreePageOffset(free_page->getNextFreePageOffset());
+
+        BufferManager::put_frame(buf_free_pg);
+        BufferManager::put_frame(buf_header);
+        return free_page_offset;
+    }
+
+    auto& num_free = FREE_PAGES(table_id);
+    auto& extent = EXTENT(table_id);
+    pagenum_t pagenum = HEADER_PAGE_NUM;
+
+    const int range = near / PAGES_PER_FREE_MAP;
+    if ( near != HEADER_PAGE_NUM && range < static_cast<int>(num_free.size()) && num_free[range] > 0 ) {
+        const pagenum_t limit = extent.next < extent.end && near < extent.next ? extent.next - near - 1 : ~0ull;
+        pagenum = take_free_page(table_id, header, range, near, limit);
+    }
+
+    if ( pagenum != HEADER_PAGE_NUM ) {
+        BufferManager::put_frame(buf_header);
+        return OFFSET(pagenum);
+    }
+
+    if ( extent.next == extent.end ) {
+        // Reuse the free pages before the file grows.
+        for ( int i = 0; i < static_cast<int>(num_free.size()); ++i ) {
+            if ( num_free[i] > 0 ) {
+                pagenum = take_free_page(table_id, header, i, static_cast<pagenum_t>(i) * PAGES_PER_FREE_MAP, ~0ull);
+                BufferManager::put_frame(buf_header);
+                return OFFSET(pagenum);
+            }
+        }
+
+        // Only if the extent has run out, the file grows by a larger one.
+        // A page of the extent is never written until it is used.
+        grow_file(table_id);
+    }
+
+    pagenum = extent.next++;
+
+    // Set Number of Pages
+    BufferManager::get_page(buf_header, true)->setNumOfPages(extent.next);
+
+    BufferManager::put_frame(buf_header);
+    return OFFSET(pagenum);
+}
+
+/*
+ *  Free an on-disk page by marking it in the free space map of its range.
+ *  The first page freed in a range becomes the map of the range.
+ *  A page which is free already, the header page, or a map is left as it is.
+ */
+void file_free_page(int table_id, pagenum_t pagenum) {
+	if ( !(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)) )
+		return;
+
+	auto buf_header = BufferManager::get_frame(table_id, HEADER_PAGE_NUM, EXCLUSIVE);
+	auto header = BufferManager::get_page(buf_header, false);
+
+	// The header page and the maps are never freed.
+	const int range = pagenum / PAGES_PER_FREE_MAP;
+	if ( pagenum == HEADER_PAGE_NUM || (range < MAX_FREE_MAP_PAGES && header->getFreeMapPage(range) == pagenum) ) {
+		BufferManager::put_frame(buf_header);
+		return;
+	}
+
+	auto buf_free_pg = BufferManager::get_frame(table_id, pagenum, EXCLUSIVE);
+	if ( range >= MAX_FREE_MAP_PAGES ) {
+		// Beyond the ranges listed in the header page, it goes to the free page list, which is allocated from first.
+		auto free_page = BufferManager::get_page(buf_free_pg, true);
+		free_page->clear();
+		free_page->setNextFreePageOffset(header->getFreePageOffset());
+		BufferManager::get_page(buf_header, true)->setFreePageOffset(OFFSET(pagenum));
+	}
+	else if ( header->getFreeMapPage(range) == HEADER_PAGE_NUM ) {
+		// Make it an empty map, which is cached like the other pages.
+		auto map = BufferManager::get_page(buf_free_pg, true);
+		map->clear();
+		map->setLeaf();
+
+		BufferManager::get_page(buf_header, true)->setFreeMapPage(range, pagenum);
+		if ( FREE_PAGES(table_id).size() <= static_cast<size_t>(range) )
+			FREE_PAGES(table_id).resize(range + 1, 0);
+
+		BufferManager::put_frame(buf_free_pg);
+		BufferManager::put_frame(buf_header);
+		return;
+	}
+	else {
+		auto buf_map = BufferManager::get_frame(table_id, header->getFreeMapPage(range), EXCLUSIVE);
+		if ( BufferManager::get_page(buf_map, false)->isFreeInMap(pagenum % PAGES_PER_FREE_MAP) ) {
+			// It is free already, and is not counted twice.
+			BufferManager::put_frame(buf_map);
+			BufferManager::put_frame(buf_free_pg);
+			BufferManager::put_frame(buf_header);
+			return;
+		}
+		BufferManager::get_page(buf_map, true)->setFreeInMap(pagenum % PAGES_PER_FREE_MAP, true);
+		BufferManager::put_frame(buf_map);
+		++FREE_PAGES(table_id)[range];
+	}
+
+	BufferManager::put_frame(buf_header);
+
+	// Free it. (Its contents don't matter any more, but it is written back if dirty.)
+	BufferManager::close_frame(buf_free_pg);
+	BufferManager::put_frame(buf_free_pg);
+}
+
+/*
+ * Open existing data file using ‘pathname’ or create one if not existed.
+ * If success, return table_id.
+ */
+int file_open_table(char * pathname, int num_column, table_mode mode){
+	if (pathname == NULL)
+        return INVALID_FILENAME;
+
+    // Find an empty slot for file descriptor.
+    int tid = 1;
+    
+    while( IS_TID_OPEN(tid) )
+        tid++;
+
+    if(tid > DEFAULT_SIZE_OF_TABLES)    
+        return FULL_FD; // FD slots are full.
+
+    // Make a file if it does not exist.
+    // Do not allow a symbolic link to open.
+    // The writes are made durable as the durability mode of the table says.
+    // In DIRECT_IO mode, the pages bypass the OS page cache, unless the file system can't do it.
+    // Permission is set to 0644.
+    DIRECT(tid) = mode == DIRECT_IO;
+    FD(tid) = open(
+        pathname,
+        O_CREAT | O_RDWR  | O_NOFOLLOW | (DIRECT(tid) ? O_DIRECT : 0), // Options
+        S_IRUSR | S_IWUSR | S_IRGRP    | S_IROTH // Permissions
+    );
+    if ( FD(tid) == -1 && DIRECT(tid) && errno == EINVAL ) {
+        DIRECT(tid) = false;
+        FD(tid) = open(pathname, O_CREAT | O_RDWR | O_NOFOLLOW, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    }
+
+    if(!initialized){
+        // Add a handler to be executed before the process exits.
+        // atexit(BufferManager::shutdown);
+
+        initialized = true;
+    }
+
+    if ( FD(tid) == -1) {
+        perror("open_db error");
+        return INVALID_FD;
+    }
+	MODE(tid) = default_mode;
+
+    Page header;
+
+    // Read the header from the file
+    ssize_t result = READ(tid, &header, HEADER_PAGE_OFFSET);
+    if (result < 0 && fall_back_from_direct_io(tid))
+        result = READ(tid, &header, HEADER_PAGE_OFFSET);
+    if (result == 0) {
+        // If the header page doesn't exist, create a new one.
+		header.clear();
+        header.setNumOfPages(1); // the number of created pages
+		header.setNumOfColumns(num_column); // the number of columns
+        if (WRITE(tid, &header, HEADER_PAGE_OFFSET) < 0 && fall_back_from_direct_io(tid))
+            WRITE(tid, &header, HEADER_PAGE_OFFSET);
+        if (MODE(tid) == FULL_SYNC)
+            fdatasync(FD(tid));
+    }
+
+	NUM_COL(tid) = header.getNumOfColumns();
+	PATH(tid) = pathname;
+
+	// The pages beyond the ones handed out are left from the last extent.
+	struct stat st;
+	EXTENT(tid).next = header.getNumOfPages();
+	EXTENT(tid).end = fstat(FD(tid), &st) == 0 ? PGNUM(st.st_size) : 0;
+	if(EXTENT(tid).end < EXTENT(tid).next)
+		EXTENT(tid).end = EXTENT(tid).next;
+	EXTENT(tid).size = 0;
+
+	// Count the free pages in the free space maps.
+	FREE_PAGES(tid).clear();
+	for(int range = 0; range < MAX_FREE_MAP_PAGES; ++range){
+		if(header.getFreeMapPage(range) == HEADER_PAGE_NUM)
+			continue;
+
+		Page map;
+		FREE_PAGES(tid).resize(range + 1, 0);
+		if(READ(tid, &map, OFFSET(header.getFreeMapPage(range))) == PAGESIZE)
+			FREE_PAGES(tid)[range] = map.countFreeInMap();
+	}
+
+	if(mode == MEMORY_MAPPED)
+		map_table(tid);
+
+	// Bring the working set of the last run back into the buffer pool.
+	BufferManager::warm_up(tid);
+
+    /* unique table id */
+    return tid;
+}
+
+/*
+ * Write the pages relating to this table to disk and close the table.
+ *  - Write all pages of this table from buffer to disk and discard the table id.
+ *  - If success, return 0. Otherwise, return non-zero value.
+ */
+int file_close_table(int table_id){
+    if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)))
+        return INVALID_TID;
+
+    // writes out the pages only from those relating to given table_id
+    BufferManager::close_table(table_id);    
+    file_sync(table_id);
+    unmap_table(table_id);
+    CLOSE(table_id);
+	DIRECT(table_id) = false;
+	FREE_PAGES(table_id).clear();
+	NUM_COL(table_id) = 0;
+	PATH(table_id).clear();
+    FD(table_id) = 0;
+	return SUCCESS;
+}
+
+/*
+ *  Save the page numbers of the working set of the table (the hottest first)
+ *  into the warm file next to the data file.
+ *  - Layout: magic number, the number of pages, and the page numbers. (8 bytes each)
+ *  - An empty working set removes the warm file.
+ */
+void file_save_working_set(int table_id, const std::vector<pagenum_t>& pages){
+	if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)))
+        return;
+
+	const std::string warm_path = WARM_PATH(table_id);
+	if(pages.empty()){
+		unlink(warm_path.c_str());
+		return;
+	}
+
+	FILE* file = fopen(warm_path.c_str(), "wb");
+	if(file == NULL){
+		perror("file_save_working_set error");
+		return;
+	}
+
+	const uint64_t header[2] = { WARM_FILE_MAGIC, pages.size() };
+	fwrite(header, sizeof(uint64_t), 2, file);
+	fwrite(pages.data(), sizeof(pagenum_t), pages.size(), file);
+	fclose(file);
+}
+
+/*
+ *  Load the saved working set of the table, which is removed as it is used,
+ *  and drop the page numbers beyond the end of the file.
+ */
+std::vector<pagenum_t> file_load_working_set(int table_id){
+	std::vector<pagenum_t> pages;
+	if(!(IS_VALID_TID(table_id) && IS_TID_OPEN(table_id)))
+        return pages;
+
+	const std::string warm_path = WARM_PATH(table_id);
+	FILE* file = fopen(warm_path.c_str(), "rb");
+	if(file == NULL)
+		return pages;
+
+	uint64_t header[2];
+	if(fread(header, sizeof(uint64_t), 2, file) == 2 && header[0] == WARM_FILE_MAGIC){
+		pages.resize(header[1]);
+		pages.resize(fread(pages.data(), sizeof(pagenum_t), pages.size(), file));
+	}
+	fclose(file);
+	unlink(warm_path.c_str());
+
+	// The file may have been changed without the warm file.
+	struct stat st;
+	const pagenum_t num_pages = fstat(FD(table_id), &st) == 0 ? PGNUM(st.st_size) : 0;
+	pages.erase(std::remove_if(pages.begin(), pages.end(), [num_pages](pagenum_t pgnum){ return pgnum >= num_pages; }), pages.end());
+
+	return pages;
+}
+
+int getNumOfCols(int table_id) noexcept
+{
+	return IS_VALID_TID(table_id) && IS_TID_OPEN(table_id) ? NUM_COL(table_id) : 0;
 }
\ No newline at end of file
@@ -1,68 +1,267 @@
-#include "index_and_file_manager.h"
-
-#include "macros.h"
-#include "wrapper_funcs.h"
-#include "buffer_manager.h"
-
-#include <stdlib.h>
-
-offset_t find_leaf( int table_id, offset_t root, record_key_t key ) {
-    offset_t c = root;
-    BufferBlock* buf = NULL;
-
-    while (c != HEADER_PAGE_OFFSET) {
-        buf = BufferManager::get_frame(table_id, PGNUM(c));
-        assert(buf != NULL);
-        auto page = BufferManager::get_page(buf, false);
-        // If the page is leaf,
-        if (page->isLeaf())
-            break; // break the loop.
-
-        // If the page is internal,
-        /* If the given key is smaller than the least key in the page */
-        if (key < page->getKey(0)) {
-            // Set the search offset to be the one-more-page-leaf-offset.
-            c = page->getOffset(0);
-        } else {
-            int index = page->binaryRangeSearch(key);
-            if (index == INVALID_KEY){
-                c = HEADER_PAGE_OFFSET;
-                break;
-            }
-            // Right side of the index
-            c = page->getOffset(index + 1);
-        }
-        BufferManager::put_frame(buf);
-    }
-    BufferManager::put_frame(buf);
-    return c;
-}
-
-record_t * find_record( int table_id, offset_t root, record_key_t key) {
-    offset_t c = find_leaf( table_id, root, key );
-    record_t* ret = NULL;
-
-    if (c == HEADER_PAGE_OFFSET) {
-        return ret;
-    }
-
-    BufferBlock* buf = NULL;
-    buf = BufferManager::get_frame(table_id, PGNUM(c));
-    assert(buf != NULL);
-    Page* leaf_page = BufferManager::get_page(buf, false);
-	
-    auto index = leaf_page->binarySearch(key);
-
-    if (index == INVALID_KEY)
-        goto error;
-
-    if (!(ret = new record_t))
-        goto error;
-
-    ret->key = leaf_page->getKey(index);
-	leaf_page->getValues(index, ret->values, getNumOfCols(table_id));
-    
-error:
-    BufferManager::put_frame(buf);
-    return ret;
-}
\ No newline at end of file
+#include "index_and_file_manager.h"
+
+#include "macros.h"
+#include "wrapper_funcs.h"
+#include "buffer_manager.h"
+#include "disk_manager.h"
+
+#include <atomic>
+#include <sched.h>
+#include <stdlib.h>
+
+/*
+ * Structure version of each table (see begin_structure_change())
+ */
+static std::atomic<uint64_t> structure_versions[DEFAULT_SIZE_OF_TABLES];
+
+/*
+ * Return the index of the child entry to follow for the given key in the internal page,
+ * or INVALID_KEY if there is none.
+ */
+static key_idx_t child_index( const Page& page, record_key_t key ) {
+    /* If the given key is smaller than the least key in the page, or the page has a single child left by a merge */
+    if (page.getNumOfKeys() == 0 || key < page.getKey(0)) {
+        // Follow the one-more-page-offset.
+        return 0;
+    }
+
+    int index = page.binaryRangeSearch(key);
+    if (index == INVALID_KEY)
+        return INVALID_KEY;
+
+    // Right side of the index
+    return index + 1;
+}
+
+/*
+ * Descend with optimistic lock coupling, which neither pins nor latches the pages.
+ * The child entry read from a page is validated before it is followed,
+ * and the page is validated once more after the version of the child has been read,
+ * so the child is the one which the page pointed at when its version was taken.
+ * The descent restarts from the root on conflict.
+ * A page which is not in the buffer pool or is being modified is read under a shared latch.
+ * After too many restarts, every page is read under a shared latch.
+ * A swizzled child entry leads to the child frame directly, and an unswizzled one is swizzled on the way.
+ */
+offset_t find_leaf( int table_id, offset_t root, record_key_t key, uint64_t* leaf_version ) {
+    offset_t c, entry, next;
+    BufferBlock* buf = NULL;
+    uint64_t version;
+    ChildEntry from; // the entry of the parent which led to this page
+    key_idx_t index;
+    bool leaf, optimistic;
+    int restarts = 0;
+
+restart:
+    entry = root;
+    from.parent = NULL;
+    while (entry != HEADER_PAGE_OFFSET) {
+        c = Page::unswizzle(entry);
+        buf = NULL;
+        optimistic = restarts < OPTIMISTIC_RESTART_LIMIT
+            && (((entry & SWIZZLED_BIT) && (buf = BufferManager::get_frame_swizzled(table_id, entry, version)) != NULL)
+                || (buf = BufferManager::get_frame_optimistic(table_id, PGNUM(c), version)) != NULL);
+        if (!optimistic)
+            buf = BufferManager::get_frame(table_id, PGNUM(c), SHARED);
+        assert(buf != NULL);
+
+        // The version of this page has been taken, so the parent is validated to hand over to it.
+        if (from.parent != NULL && !BufferManager::validate(from.parent, from.version)) {
+            if (!optimistic)
+                BufferManager::put_frame(buf);
+            ++restarts;
+            goto restart;
+        }
+
+        if (optimistic) {
+            const Page& page = buf->getPage();
+            leaf = page.isLeaf();
+            index = leaf ? INVALID_KEY : child_index(page, key);
+            next = index == INVALID_KEY ? HEADER_PAGE_OFFSET : page.getChildEntry(index);
+            // The entry is followed only if it has been read from a consistent page.
+            if (!BufferManager::validate(buf, version)) {
+                ++restarts;
+                goto restart;
+            }
+        } else {
+            const Page& page = *BufferManager::get_page(buf, false);
+            leaf = page.isLeaf();
+            index = leaf ? INVALID_KEY : child_index(page, key);
+            next = index == INVALID_KEY ? HEADER_PAGE_OFFSET : page.getChildEntry(index);
+            version = buf->getVersion();
+            BufferManager::put_frame(buf);
+        }
+
+        // Point the parent at this page from now on.
+        if (from.parent != NULL)
+            BufferManager::swizzle(table_id, from, buf, PGNUM(c));
+
+        // The leaf page has been reached.
+        if (leaf)
+            break;
+
+        from = { buf, PGNUM(c), version, index, next };
+        entry = next;
+    }
+
+    if (entry == HEADER_PAGE_OFFSET)
+        return HEADER_PAGE_OFFSET;
+    if (leaf_version != NULL)
+        *leaf_version = version;
+    return c;
+}
+
+/*
+ * Descend the mapping of the table to the leaf page which may have the key. (nullptr if there is none)
+ * An update may change the pages while they are read, so a page which doesn't look like a node,
+ * or an offset beyond the mapping, makes it return false.
+ * The caller validates what it has read.
+ */
+bool find_leaf_mapped( int table_id, record_key_t key, const Page*& leaf ) {
+    const Page* page = file_mapped_page(table_id, HEADER_PAGE_NUM);
+    if (page == NULL)
+        return false;
+
+    offset_t c = page->getRootPageOffset();
+    key_idx_t index;
+
+    leaf = NULL;
+    for (int depth = 0; c != HEADER_PAGE_OFFSET; ++depth) {
+        if ((page = file_mapped_page(table_id, PGNUM(c))) == NULL || depth > MAX_MAPPED_TREE_HEIGHT)
+            return false;
+        if (page->getNumOfKeys() < 0
+            || page->getNumOfKeys() >= (page->isLeaf() ? DEFAULT_LEAF_ORDER : DEFAULT_INTERNAL_ORDER))
+            return false;
+
+        // The leaf page has been reached.
+        if (page->isLeaf()) {
+            leaf = page;
+            break;
+        }
+
+        if ((index = child_index(*page, key)) == INVALID_KEY)
+            break;
+        c = page->getOffset(index);
+    }
+    return true;
+}
+
+/*
+ * Find the record in the mapping of the table, without the buffer pool.
+ * Return false if the mapping can't answer: the table is not mapped, is being updated,
+ * or keeps changing while it is read. The caller reads it through the buffer pool then.
+ */
+bool find_record_mapped( int table_id, record_key_t key, record_t*& result ) {
+    const auto num_cols = getNumOfCols(table_id);
+    const Page* leaf;
+    record_t record;
+    key_idx_t index;
+    uint64_t version;
+
+    for (int restarts = 0; restarts < OPTIMISTIC_RESTART_LIMIT; ++restarts) {
+        if (!file_map_begin(table_id, version))
+            return false;
+        if (!find_leaf_mapped(table_id, key, leaf))
+            continue;
+
+        index = leaf == NULL ? INVALID_KEY : leaf->binarySearch(key);
+        if (index != INVALID_KEY) {
+            record.key = leaf->getKey(index);
+            leaf->getValues(index, record.values, num_cols);
+        }
+
+        if (file_map_validate(table_id, version)) {
+            result = index == INVALID_KEY ? NULL : new record_t(record);
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Read the record from the leaf page found by find_leaf().
+ * The leaf is read only in the version which the descent has validated,
+ * so a record moved away by a split in the meantime is searched for again from the root.
+ */
+record_t * find_record( int table_id, offset_t root, record_key_t key) {
+    record_t* ret = NULL;
+    record_t record;
+    const auto num_cols = getNumOfCols(table_id);
+    uint64_t leaf_version, version;
+    key_idx_t index;
+
+    for (;;) {
+        offset_t c = find_leaf( table_id, root, key, &leaf_version );
+        if (c == HEADER_PAGE_OFFSET)
+            return NULL;
+
+        // Try to copy the record out optimistically first.
+        BufferBlock* buf = BufferManager::get_frame_optimistic(table_id, PGNUM(c), version);
+        if (buf != NULL && version == leaf_version) {
+            const Page& leaf_page = buf->getPage();
+            index = leaf_page.binarySearch(key);
+            if (index != INVALID_KEY) {
+                record.key = leaf_page.getKey(index);
+                leaf_page.getValues(index, record.values, num_cols);
+            }
+
+            if (BufferManager::validate(buf, version))
+                return index == INVALID_KEY ? NULL : new record_t(record);
+            continue;
+        }
+
+        buf = BufferManager::get_frame(table_id, PGNUM(c), SHARED);
+        assert(buf != NULL);
+        if (buf->getVersion() != leaf_version) {
+            BufferManager::put_frame(buf);
+            continue;
+        }
+
+        Page* leaf_page = BufferManager::get_page(buf, false);
+        index = leaf_page->binarySearch(key);
+        if (index != INVALID_KEY) {
+            ret = new record_t;
+            ret->key = leaf_page->getKey(index);
+            leaf_page->getValues(index, ret->values, num_cols);
+        }
+        BufferManager::put_frame(buf);
+        return ret;
+    }
+}
+
+/*
+ * Make the structure version of the table odd, unless a change has begun already.
+ */
+void begin_structure_change( int table_id ) {
+    auto& version = structure_versions[table_id - 1];
+    if (!(version.load(std::memory_order_relaxed) & 1))
+        version.fetch_add(1, std::memory_order_acq_rel);
+}
+
+/*
+ * Make the structure version of the table even again, once the root offset has been updated.
+ */
+void end_structure_change( int table_id ) {
+    auto& version = structure_versions[table_id - 1];
+    if (version.load(std::memory_order_relaxed) & 1)
+        version.fetch_add(1, std::memory_order_release);
+}
+
+/*
+ * Return the structure version of the table, after a change in progress has ended.
+ */
+uint64_t structure_version_begin( int table_id ) {
+    uint64_t version;
+    while ((version = structure_versions[table_id - 1].load(std::memory_order_acquire)) & 1)
+        sched_yield();
+    return version;
+}
+
+/*
+ * Check that the structure of the table has not been changed since structure_version_begin().
+ */
+bool structure_version_validate( int table_id, uint64_t version ) {
+    // The reads of the pages must not be reordered after the version check.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return structure_versions[table_id - 1].load(std::memory_order_relaxed) == version;
+}
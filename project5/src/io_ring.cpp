@@ -0,0 +1,267 @@
+#include "io_ring.h"
+
+#include <cerrno>
+#include <cstdio> /* perror */
+#include <cstring> /* memset */
+#include <sys/mman.h> /* mmap */
+#include <sys/syscall.h> /* io_uring system calls */
+#include <unistd.h> /* syscall, close */
+
+/* The completion of the data sync linked to a write is tagged in the lowest bit. (Requests are aligned) */
+#define SYNC_TAG 1ull
+
+static thread_local std::unique_ptr<IoRing> ring;
+static thread_local bool ring_tried = false;
+
+// IO Ring
+
+IoRing::IoRing()
+	:fd(-1), sq_ring(MAP_FAILED), sq_ring_size(0), sq_head(nullptr), sq_tail(nullptr), sq_mask(0), sq_array(nullptr),
+	sqes(static_cast<io_uring_sqe*>(MAP_FAILED)), sqes_size(0),
+	cq_ring(MAP_FAILED), cq_ring_size(0), cq_head(nullptr), cq_tail(nullptr), cq_mask(0), cqes(nullptr),
+	requests(), free_requests(), num_in_flight(0), num_queued(0)
+{
+
+}
+
+IoRing::~IoRing()
+{
+	if(fd < 0)
+		return;
+
+	// The buffers of the requests in flight belong to the callers.
+	wait();
+
+	if(sqes != MAP_FAILED)
+		munmap(sqes, sqes_size);
+	if(cq_ring != MAP_FAILED && cq_ring != sq_ring)
+		munmap(cq_ring, cq_ring_size);
+	if(sq_ring != MAP_FAILED)
+		munmap(sq_ring, sq_ring_size);
+	close(fd);
+}
+
+/*
+ *  Set up the ring and map its queues.
+ *  The completion queue is twice as long as the submission queue,
+ *  which leaves room for the linked data syncs of the requests in flight.
+ */
+bool IoRing::setup(unsigned entries)
+{
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+	if(fd < 0)
+		return false;
+
+	sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	if(params.features & IORING_FEAT_SINGLE_MMAP){
+		if(cq_ring_size > sq_ring_size)
+			sq_ring_size = cq_ring_size;
+		cq_ring_size = sq_ring_size;
+	}
+
+	sq_ring = mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if(sq_ring == MAP_FAILED)
+		return false;
+
+	cq_ring = params.features & IORING_FEAT_SINGLE_MMAP ? sq_ring
+		: mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+	if(cq_ring == MAP_FAILED)
+		return false;
+
+	sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+	sqes = static_cast<io_uring_sqe*>(mmap(NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+	if(sqes == MAP_FAILED)
+		return false;
+
+	byte* sq = static_cast<byte*>(sq_ring);
+	sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+	sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+	sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+	sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+	byte* cq = static_cast<byte*>(cq_ring);
+	cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+	cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+	cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+	cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+	requests.reset(new Request[IO_QUEUE_DEPTH]);
+	for(int i = IO_QUEUE_DEPTH - 1; i >= 0; --i)
+		free_requests.push_back(&requests[i]);
+
+	return true;
+}
+
+IoRing* IoRing::local()
+{
+	if(ring == nullptr && !ring_tried){
+		ring_tried = true;
+
+		std::unique_ptr<IoRing> created(new IoRing());
+		if(created->setup(IO_QUEUE_DEPTH))
+			ring = std::move(created);
+	}
+	return ring.get();
+}
+
+IoRing* IoRing::current()
+{
+	return ring.get();
+}
+
+IoRing::Request* IoRing::newRequest(io_callback done, void* arg, int64_t expected)
+{
+	// Every request is in flight, so wait for one.
+	if(free_requests.empty())
+		wait(num_in_flight - 1);
+
+	Request* request = free_requests.back();
+	free_requests.pop_back();
+	++num_in_flight;
+
+	request->done = done;
+	request->arg = arg;
+	request->result = 0;
+	request->expected = expected;
+	request->pending = 1;
+	return request;
+}
+
+// The queue never fills up, since the submissions are handed to the kernel as soon as they are filled.
+io_uring_sqe* IoRing::nextSubmission()
+{
+	const unsigned index = (*sq_tail + num_queued++) & sq_mask;
+	io_uring_sqe* sqe = &sqes[index];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sq_array[index] = index;
+	return sqe;
+}
+
+void IoRing::enter(unsigned min_complete)
+{
+	unsigned to_submit = num_queued;
+	if(num_queued){
+		// Publish the filled submissions to the kernel.
+		__atomic_store_n(sq_tail, *sq_tail + num_queued, __ATOMIC_RELEASE);
+		num_queued = 0;
+	}
+
+	for(;;){
+		const int submitted = static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+			min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0));
+
+		if(submitted >= 0){
+			to_submit -= submitted;
+			if(to_submit == 0)
+				return;
+			continue;
+		}
+
+		if(errno == EINTR)
+			continue;
+		// The completion queue is short of room, so make some.
+		if((errno == EAGAIN || errno == EBUSY) && reap() > 0)
+			continue;
+
+		perror("io_uring_enter error");
+		return;
+	}
+}
+
+int IoRing::reap()
+{
+	int num_done = 0;
+	unsigned head = *cq_head;
+	const unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+
+	for(; head != tail; ++head){
+		const io_uring_cqe& cqe = cqes[head & cq_mask];
+		const bool sync = cqe.user_data & SYNC_TAG;
+		Request* request = reinterpret_cast<Request*>(cqe.user_data & ~SYNC_TAG);
+
+		// The first failure is reported: a short write cancels the linked sync.
+		if(!sync)
+			request->result = cqe.res;
+		else if(cqe.res < 0 && request->result == request->expected)
+			request->result = cqe.res;
+
+		if(--request->pending > 0)
+			continue;
+
+		// The request can be used again by the callback.
+		const io_callback done = request->done;
+		void* const arg = request->arg;
+		const int64_t result = request->result;
+		request->iov.clear();
+		free_requests.push_back(request);
+		--num_in_flight;
+		++num_done;
+
+		__atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+		done(arg, result);
+	}
+
+	__atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+	return num_done;
+}
+
+void IoRing::read(int file, void* buf, size_t len, off_t offset, io_callback done, void* arg)
+{
+	Request* request = newRequest(done, arg, static_cast<int64_t>(len));
+	request->iov.push_back({ buf, len });
+
+	io_uring_sqe* sqe = nextSubmission();
+	sqe->opcode = IORING_OP_READV;
+	sqe->fd = file;
+	sqe->addr = reinterpret_cast<uint64_t>(request->iov.data());
+	sqe->len = 1;
+	sqe->off = offset;
+	sqe->user_data = reinterpret_cast<uint64_t>(request);
+
+	enter(0);
+}
+
+void IoRing::writev(int file, std::vector<iovec>&& iov, off_t offset, bool sync, io_callback done, void* arg)
+{
+	int64_t len = 0;
+	for(const auto& v : iov)
+		len += v.iov_len;
+
+	Request* request = newRequest(done, arg, len);
+	request->iov = std::move(iov);
+
+	io_uring_sqe* sqe = nextSubmission();
+	sqe->opcode = IORING_OP_WRITEV;
+	sqe->fd = file;
+	sqe->addr = reinterpret_cast<uint64_t>(request->iov.data());
+	sqe->len = static_cast<uint32_t>(request->iov.size());
+	sqe->off = offset;
+	sqe->user_data = reinterpret_cast<uint64_t>(request);
+
+	if(sync){
+		// The data sync starts only after the write has succeeded.
+		sqe->flags |= IOSQE_IO_LINK;
+		++request->pending;
+
+		sqe = nextSubmission();
+		sqe->opcode = IORING_OP_FSYNC;
+		sqe->fd = file;
+		sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+		sqe->user_data = reinterpret_cast<uint64_t>(request) | SYNC_TAG;
+	}
+
+	enter(0);
+}
+
+void IoRing::wait(int max_in_flight)
+{
+	while(num_in_flight > max_in_flight){
+		if(reap() == 0)
+			enter(1);
+	}
+}
@@ -1,181 +1,262 @@
-#include "page.h"
-
-#include <cstring>
-
-Page::Page()
-{
-	clear();
-}
-
-// Getters and Setters
-
-// for Header Page
-
-// -> Setters
-void Page::setFreePageOffset(offset_t free_page_offset)
-{
-	this->free_page_offset = free_page_offset;
-}
-
-void Page::setRootPageOffset(offset_t root_page_offset)
-{
-	this->root_page_offset = root_page_offset;
-}
-
-void Page::setNumOfPages(pagenum_t num_of_page)
-{
-	this->num_of_pages = num_of_page;
-}
-
-void Page::setNumOfColumns(table_colnum_t num_of_column)
-{
-	this->num_of_columns = num_of_column;
-} 
-
-// for Free Page
-
-// -> Setters
-void Page::setNextFreePageOffset(offset_t next_free_page_offset) {
-    this->next_free_page_offset = next_free_page_offset;
-}
-
-// for Node Page
-
-std::vector<record_val_t> Page::getRecord(key_idx_t index, int num_column)
-{
-	std::vector<record_val_t> result(num_column);
-	
-	if ( isLeaf() && index < DEFAULT_LEAF_ORDER - 1 )
-	{
-		result[0] = records[index].key;
-		for ( auto i = 1; i < num_column; ++i )
-			result[i] = records[index].values[i - 1];
-	}
-	return result;
-}
-
-// -> Setters
-int Page::setParentOffset(offset_t offset) {
-    this->offset = offset;
-    return SUCCESS;
-}
-int Page::setLeaf() {
-    this->isLeafNode = true;
-    return SUCCESS;
-}
-int Page::setInternal() {
-    this->isLeafNode = false;
-    return SUCCESS;
-}
-int Page::setNumOfKeys(key_idx_t num_keys) {
-    this->num_keys = num_keys;
-    return SUCCESS;
-}
-int Page::setKey(key_idx_t index, record_key_t key) {
-    if (!isLeaf()) {
-        // Internal Page : 0 ≤ index < DEFAULT_INTERNAL_ORDER - 1
-        if (index >= DEFAULT_INTERNAL_ORDER - 1)
-            return INVALID_INDEX;
-
-        this->pairs[index].key = key;
-        return SUCCESS;
-    } else {
-        // Leaf Page : 0 ≤ index < DEFAULT_LEAF_ORDER - 1
-        if (index >= DEFAULT_LEAF_ORDER - 1)
-            return INVALID_INDEX;
-
-        this->records[index].key = key;
-		return SUCCESS;
-    }
-}
-int Page::setOffset(key_idx_t index, offset_t offset) {
-    if (!isLeaf()) {
-        // Internal Page : 0 ≤ index < DEFAULT_INTERNAL_ORDER
-        if (index >= DEFAULT_INTERNAL_ORDER)
-            return INVALID_INDEX;
-        else if (index == 0)
-            this->one_more_page_offset = offset;
-        else
-            this->pairs[index - 1].offset = offset;
-        return SUCCESS;
-    } else {
-        // Leaf Page : index == DEFAULT_LEAF_ORDER - 1
-        if (index == DEFAULT_LEAF_ORDER - 1) {
-            this->right_sibling_page_offset = offset;
-            return SUCCESS;
-        } else {
-            return INVALID_INDEX;
-        }
-    }
-}
-int Page::setValues(key_idx_t index, const record_val_t* src, int num_column) {
-    if (isLeaf()) {
-        // Leaf Page : 0 ≤ index < DEFAULT_LEAF_ORDER - 1
-        if (index >= DEFAULT_LEAF_ORDER - 1) {
-            return INVALID_INDEX;
-        }
-		if(src==nullptr)
-			std::memset(this->records[index].values, 0, (MAX_NUM_COLUMNS - 1) * sizeof(record_val_t));
-		else
-			std::memcpy(this->records[index].values, src, (num_column - 1) * sizeof(record_val_t));
-        return SUCCESS;
-    } else {
-        return INVALID_PAGE;
-    }
-}
-
-int Page::binarySearch(record_key_t key) const
-{
-	int l, r, m, middle_key;
-	l = 0;
-	r = getNumOfKeys() - 1;
-	while ( l <= r )
-	{
-		m = (l + r) / 2;
-		middle_key = getKey(m);
-		if ( middle_key < key )
-			l = m + 1;
-		else if ( middle_key > key )
-			r = m - 1;
-		else
-			return m;
-	}
-	return INVALID_KEY; /* cannot find the given key in the page */
-}
-
-int Page::binaryRangeSearch(record_key_t key) const
-{
-	/* Modified Version of Binary Search */
-	int l, r, m, middle_key;
-	l = 0;
-	r = getNumOfKeys();
-	while ( l < r )
-	{
-		m = (l + r) / 2;
-
-		if ( l == m )
-			return m;
-
-		middle_key = getKey(m);
-		if ( middle_key <= key )
-			l = m;
-		else
-			r = m;
-	}
-	return INVALID_KEY; /* No Key is provided. */
-}
-
-void Page::clear()
-{
-	memset(page, 0, PAGESIZE);
-}
-
-void* Page::operator&()
-{
-	return &page;
-}
-
-const void* Page::operator&() const
-{
-	return const_cast<Page *>(this)->operator&();
+#include "page.h"
+
+#include <cstring>
+
+Page::Page()
+{
+	clear();
+}
+
+// Getters and Setters
+
+// for Header Page
+
+// -> Setters
+void Page::setFreePageOffset(offset_t free_page_offset)
+{
+	this->free_page_offset = free_page_offset;
+}
+
+void Page::setRootPageOffset(offset_t root_page_offset)
+{
+	this->root_page_offset = root_page_offset;
+}
+
+void Page::setNumOfPages(pagenum_t num_of_page)
+{
+	this->num_of_pages = num_of_page;
+}
+
+void Page::setNumOfColumns(table_colnum_t num_of_column)
+{
+	this->num_of_columns = num_of_column;
+} 
+
+void Page::setFreeMapPage(int index, pagenum_t pagenum)
+{
+	this->free_map_pages[index] = pagenum;
+}
+
+// for Free Page
+
+// -> Setters
+void Page::setNextFreePageOffset(offset_t next_free_page_offset) {
+    this->next_free_page_offset = next_free_page_offset;
+}
+
+// for Free Space Map Page
+
+// -> Getters
+int Page::countFreeInMap() const
+{
+	int count = 0;
+	for ( auto word : free_map )
+		count += __builtin_popcountll(word);
+	return count;
+}
+
+/*
+ *  The first free page from the given index, so that a page allocated near another follows it,
+ *  or the last one before the index if there is none after it.
+ */
+int Page::findFreeInMap(int near) const
+{
+	constexpr int num_words = PAGES_PER_FREE_MAP / 64;
+	const int home = near / 64;
+	const int bit = near % 64;
+
+	const uint64_t above = free_map[home] >> bit;
+	if ( above )
+		return near + __builtin_ctzll(above);
+	for ( int i = home + 1; i < num_words; ++i )
+		if ( free_map[i] )
+			return i * 64 + __builtin_ctzll(free_map[i]);
+
+	const uint64_t below = bit ? free_map[home] << (64 - bit) : 0;
+	if ( below )
+		return near - 1 - __builtin_clzll(below);
+	for ( int i = home - 1; i >= 0; --i )
+		if ( free_map[i] )
+			return i * 64 + 63 - __builtin_clzll(free_map[i]);
+	return -1;
+}
+
+// -> Setters
+void Page::setFreeInMap(int index, bool free)
+{
+	if ( free )
+		free_map[index / 64] |= 1ull << (index % 64);
+	else
+		free_map[index / 64] &= ~(1ull << (index % 64));
+}
+
+// for Node Page
+
+std::vector<record_val_t> Page::getRecord(key_idx_t index, int num_column)
+{
+	std::vector<record_val_t> result(num_column);
+	
+	if ( isLeaf() && index < DEFAULT_LEAF_ORDER - 1 )
+	{
+		result[0] = records[index].key;
+		for ( auto i = 1; i < num_column; ++i )
+			result[i] = records[index].values[i - 1];
+	}
+	return result;
+}
+
+// -> Setters
+int Page::setParentOffset(offset_t offset) {
+    this->offset = offset;
+    return SUCCESS;
+}
+int Page::setLeaf() {
+    this->isLeafNode = true;
+    return SUCCESS;
+}
+int Page::setInternal() {
+    this->isLeafNode = false;
+    return SUCCESS;
+}
+int Page::setNumOfKeys(key_idx_t num_keys) {
+    this->num_keys = num_keys;
+    return SUCCESS;
+}
+int Page::setKey(key_idx_t index, record_key_t key) {
+    if (!isLeaf()) {
+        // Internal Page : 0 ≤ index < DEFAULT_INTERNAL_ORDER - 1
+        if (index >= DEFAULT_INTERNAL_ORDER - 1)
+            return INVALID_INDEX;
+
+        this->pairs[index].key = key;
+        return SUCCESS;
+    } else {
+        // Leaf Page : 0 ≤ index < DEFAULT_LEAF_ORDER - 1
+        if (index >= DEFAULT_LEAF_ORDER - 1)
+            return INVALID_INDEX;
+
+        this->records[index].key = key;
+		return SUCCESS;
+    }
+}
+int Page::setOffset(key_idx_t index, offset_t offset) {
+    if (!isLeaf()) {
+        // Internal Page : 0 ≤ index < DEFAULT_INTERNAL_ORDER
+        if (index >= DEFAULT_INTERNAL_ORDER)
+            return INVALID_INDEX;
+        else if (index == 0)
+            this->one_more_page_offset = offset;
+        else
+            this->pairs[index - 1].offset = offset;
+        return SUCCESS;
+    } else {
+        // Leaf Page : index == DEFAULT_LEAF_ORDER - 1
+        if (index == DEFAULT_LEAF_ORDER - 1) {
+            this->right_sibling_page_offset = offset;
+            return SUCCESS;
+        } else {
+            return INVALID_INDEX;
+        }
+    }
+}
+int Page::setValues(key_idx_t index, const record_val_t* src, int num_column) {
+    if (isLeaf()) {
+        // Leaf Page : 0 ≤ index < DEFAULT_LEAF_ORDER - 1
+        if (index >= DEFAULT_LEAF_ORDER - 1) {
+            return INVALID_INDEX;
+        }
+		if(src==nullptr)
+			std::memset(this->records[index].values, 0, (MAX_NUM_COLUMNS - 1) * sizeof(record_val_t));
+		else
+			std::memcpy(this->records[index].values, src, (num_column - 1) * sizeof(record_val_t));
+        return SUCCESS;
+    } else {
+        return INVALID_PAGE;
+    }
+}
+
+// -> Pointer Swizzling
+
+/*
+ * Replace the child entry with another form of the same offset, unless it has been changed.
+ * The entry is swapped in a single store, so the readers see either form of it.
+ */
+void Page::swizzleChildEntry(key_idx_t index, offset_t expected, offset_t entry)
+{
+	if ( isLeaf() || index < 0 || index >= DEFAULT_INTERNAL_ORDER )
+		return;
+
+	offset_t* target = index == 0 ? &this->one_more_page_offset : &this->pairs[index - 1].offset;
+	__atomic_compare_exchange_n(target, &expected, entry, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+/*
+ * Copy the page with its child offsets unswizzled, which is how it is written to the disk.
+ * (The unused entries are unswizzled as well, since they may be shifted in later.)
+ */
+void Page::copyUnswizzled(Page& dest) const
+{
+	std::memcpy(dest.page, this->page, PAGESIZE);
+	if ( dest.isLeaf() )
+		return;
+
+	dest.one_more_page_offset = unswizzle(dest.one_more_page_offset);
+	for ( auto i = 0; i < DEFAULT_INTERNAL_ORDER - 1; ++i )
+		dest.pairs[i].offset = unswizzle(dest.pairs[i].offset);
+}
+
+int Page::binarySearch(record_key_t key) const
+{
+	int l, r, m, middle_key;
+	l = 0;
+	r = getNumOfKeys() - 1;
+	while ( l <= r )
+	{
+		m = (l + r) / 2;
+		middle_key = getKey(m);
+		if ( middle_key < key )
+			l = m + 1;
+		else if ( middle_key > key )
+			r = m - 1;
+		else
+			return m;
+	}
+	return INVALID_KEY; /* cannot find the given key in the page */
+}
+
+int Page::binaryRangeSearch(record_key_t key) const
+{
+	/* Modified Version of Binary Search */
+	int l, r, m, middle_key;
+	l = 0;
+	r = getNumOfKeys();
+	while ( l < r )
+	{
+		m = (l + r) / 2;
+
+		if ( l == m )
+			return m;
+
+		middle_key = getKey(m);
+		if ( middle_key <= key )
+			l = m;
+		else
+			r = m;
+	}
+	return INVALID_KEY; /* No Key is provided. */
+}
+
+void Page::clear()
+{
+	memset(page, 0, PAGESIZE);
+}
+
+void* Page::operator&()
+{
+	return &page;
+}
+
+const void* Page::operator&() const
+{
+	return const_cast<Page *>(this)->operator&();
 }
\ No newline at end of file
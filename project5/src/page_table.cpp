@@ -0,0 +1,143 @@
+#include "page_table.h"
+
+// Page Table
+
+PageTable::PageTable()
+	:current(allocate(2 * MIN_SIZE_OF_PARTITION)), outgrown(), size(0)
+{
+
+}
+
+PageTable::~PageTable()
+{
+	outgrown.push_back(current.load());
+	for ( auto table : outgrown )
+	{
+		delete[] table->slots;
+		delete table;
+	}
+}
+
+PageTable::Slots* PageTable::allocate(size_t capacity)
+{
+	Slots* table = new Slots{ new Slot[capacity], capacity - 1 };
+	for ( size_t i = 0; i < capacity; ++i )
+	{
+		table->slots[i].key.store(0, std::memory_order_relaxed);
+		table->slots[i].block.store(nullptr, std::memory_order_relaxed);
+	}
+	return table;
+}
+
+BufferBlock* PageTable::find(uint64_t key) const
+{
+	const Slots* table = current.load(std::memory_order_acquire);
+
+	for ( size_t i = home(key, table->mask), n = 0; n <= table->mask; i = (i + 1) & table->mask, ++n )
+	{
+		const uint64_t k = table->slots[i].key.load(std::memory_order_acquire);
+		if ( k == key )
+			return table->slots[i].block.load(std::memory_order_acquire);
+		if ( k == 0 )
+			break;
+	}
+	return nullptr;
+}
+
+/*
+ *  The block is stored before the key,
+ *  so a reader which sees the key sees a block with it. (maybe a later one)
+ */
+void PageTable::place(Slots* table, uint64_t key, BufferBlock* block)
+{
+	size_t i = home(key, table->mask);
+	while ( true )
+	{
+		const uint64_t k = table->slots[i].key.load(std::memory_order_relaxed);
+		if ( k == key || k == 0 )
+			break;
+		i = (i + 1) & table->mask;
+	}
+
+	table->slots[i].block.store(block, std::memory_order_release);
+	table->slots[i].key.store(key, std::memory_order_release);
+}
+
+void PageTable::insert(uint64_t key, BufferBlock* block)
+{
+	reserve(size + 1);
+
+	Slots* table = current.load(std::memory_order_relaxed);
+	if ( find(key) == nullptr )
+		++size;
+	place(table, key, block);
+}
+
+/*
+ *  Backward shift deletion: no tombstones are left behind,
+ *  so the probe sequences never get longer than the load factor allows.
+ */
+void PageTable::erase(uint64_t key)
+{
+	Slots* table = current.load(std::memory_order_relaxed);
+	const size_t mask = table->mask;
+
+	size_t hole = home(key, mask);
+	while ( true )
+	{
+		const uint64_t k = table->slots[hole].key.load(std::memory_order_relaxed);
+		if ( k == 0 )
+			return;
+		if ( k == key )
+			break;
+		hole = (hole + 1) & mask;
+	}
+	--size;
+
+	for ( size_t i = (hole + 1) & mask; ; i = (i + 1) & mask )
+	{
+		const uint64_t k = table->slots[i].key.load(std::memory_order_relaxed);
+		if ( k == 0 )
+			break;
+
+		// Move the entry back if the hole lies on its probe sequence.
+		const size_t h = home(k, mask);
+		if ( ((i - h) & mask) >= ((i - hole) & mask) )
+		{
+			table->slots[hole].block.store(table->slots[i].block.load(std::memory_order_relaxed), std::memory_order_release);
+			table->slots[hole].key.store(k, std::memory_order_release);
+			hole = i;
+		}
+	}
+	table->slots[hole].key.store(0, std::memory_order_release);
+}
+
+void PageTable::reserve(size_t n)
+{
+	Slots* table = current.load(std::memory_order_relaxed);
+	if ( 2 * n <= table->mask + 1 )
+		return;
+
+	size_t capacity = table->mask + 1;
+	while ( capacity < 2 * n )
+		capacity *= 2;
+
+	Slots* grown = allocate(capacity);
+	for ( size_t i = 0; i <= table->mask; ++i )
+	{
+		const uint64_t k = table->slots[i].key.load(std::memory_order_relaxed);
+		if ( k != 0 )
+			place(grown, k, table->slots[i].block.load(std::memory_order_relaxed));
+	}
+
+	current.store(grown, std::memory_order_release);
+	outgrown.push_back(table);
+}
+
+void PageTable::clear()
+{
+	Slots* table = current.load(std::memory_order_relaxed);
+	for ( size_t i = 0; i <= table->mask; ++i )
+		table->slots[i].key.store(0, std::memory_order_release);
+	size = 0;
+}
@@ -0,0 +1,347 @@
+#include "replacement_policy.h"
+#include "buffer_manager.h"
+
+#include <algorithm> /* max, find */
+
+// Replacement Policy
+
+ReplacementPolicy* ReplacementPolicy::create(policy_type type)
+{
+	switch ( type )
+	{
+	case CLOCK:
+		return new ClockPolicy();
+	case TWO_Q:
+		return new TwoQPolicy();
+	case LRU:
+	default:
+		return new LRUPolicy();
+	}
+}
+
+bool ReplacementPolicy::isReplaceable(const BufferBlock* block, bool clean_only, const VictimFilter* filter)
+{
+	return block->pin_cnt == 0 && !(clean_only && block->dirty)
+		&& (filter == nullptr || ((!filter->spare_index_pages || !block->index_page.load(std::memory_order_relaxed))
+			&& (!filter->honor_quotas || BufferManager::honorsQuota(block, *filter))));
+}
+
+// LRU
+
+LRUPolicy::LRUPolicy()
+	:pool(nullptr)
+{
+
+}
+
+void LRUPolicy::add(BufferBlock* block)
+{
+	if ( pool == nullptr )
+	{
+		block->next = block->prev = block;
+		pool = block;
+		return;
+	}
+
+	/* Put it at the LRU end of the list. */
+	block->next = pool->next;
+	block->prev = pool;
+	block->next->prev = block;
+	block->prev->next = block;
+	pool = block;
+}
+
+void LRUPolicy::remove(BufferBlock* block)
+{
+	if ( block->next == block )
+	{
+		pool = nullptr;
+		return;
+	}
+
+	if ( block == pool )
+		pool = pool->prev;
+	block->prev->next = block->next;
+	block->next->prev = block->prev;
+	block->next = block->prev = nullptr;
+}
+
+void LRUPolicy::access(BufferBlock* p)
+{
+	/* Put it at the front of the list. */
+	if ( p == pool )
+	{
+		pool = pool->prev;
+	}
+	else
+	{
+		p->prev->next = p->next;
+		p->next->prev = p->prev;
+		p->prev = pool;
+		p->next = pool->next;
+		p->prev->next = p;
+		p->next->prev = p;
+	}
+}
+
+BufferBlock* LRUPolicy::victim(bool clean_only, const VictimFilter* filter)
+{
+	if ( pool == nullptr )
+		return nullptr;
+
+	/* Find a replaceable block from the LRU end */
+	BufferBlock* p = pool;
+	while ( !isReplaceable(p, clean_only, filter) )
+	{
+		p = p->prev;
+		if ( p == pool )
+			return nullptr;
+	}
+	return p;
+}
+
+void LRUPolicy::coldest(std::vector<BufferBlock*>& dest, size_t n)
+{
+	if ( pool == nullptr )
+		return;
+
+	BufferBlock* p = pool;
+	do
+	{
+		dest.push_back(p);
+		p = p->prev;
+	} while ( --n && p != pool );
+}
+
+// CLOCK
+
+ClockPolicy::ClockPolicy()
+	:blocks(), hand(0)
+{
+
+}
+
+void ClockPolicy::add(BufferBlock* block)
+{
+	block->referenced = false;
+	blocks.push_back(block);
+}
+
+void ClockPolicy::remove(BufferBlock* block)
+{
+	auto it = std::find(blocks.begin(), blocks.end(), block);
+	if ( it == blocks.end() )
+		return;
+
+	/* Keep the hand on the same block. */
+	if ( static_cast<size_t>(it - blocks.begin()) < hand )
+		--hand;
+	blocks.erase(it);
+	if ( hand >= blocks.size() )
+		hand = 0;
+}
+
+void ClockPolicy::access(BufferBlock* block)
+{
+	/* No list manipulation, only the reference bit. */
+	if ( !block->referenced.load(std::memory_order_relaxed) )
+		block->referenced.store(true, std::memory_order_relaxed);
+}
+
+BufferBlock* ClockPolicy::victim(bool clean_only, const VictimFilter* filter)
+{
+	const size_t size = blocks.size();
+
+	/* Two rounds are enough to clear every reference bit. */
+	for ( size_t step = 0; step < 2 * size; ++step )
+	{
+		BufferBlock* p = blocks[hand];
+		hand = (hand + 1) % size;
+
+		if ( !isReplaceable(p, clean_only, filter) )
+			continue;
+
+		if ( p->referenced.load(std::memory_order_relaxed) )
+		{
+			/* Second chance */
+			p->referenced.store(false, std::memory_order_relaxed);
+			continue;
+		}
+		return p;
+	}
+	return nullptr;
+}
+
+void ClockPolicy::coldest(std::vector<BufferBlock*>& dest, size_t n)
+{
+	const size_t size = blocks.size();
+
+	/* The blocks right after the hand are swept first. */
+	for ( size_t i = 0; i < size && i < n; ++i )
+		dest.push_back(blocks[(hand + i) % size]);
+}
+
+// 2Q
+
+TwoQPolicy::TwoQPolicy()
+	:free_queue{ nullptr, nullptr, 0 }, a1in{ nullptr, nullptr, 0 }, am{ nullptr, nullptr, 0 },
+	a1out(), a1out_index(), size(0)
+{
+
+}
+
+TwoQPolicy::Queue& TwoQPolicy::queueOf(BufferBlock* block)
+{
+	switch ( block->queue )
+	{
+	case A1IN:
+		return a1in;
+	case AM:
+		return am;
+	case FREE:
+	default:
+		return free_queue;
+	}
+}
+
+void TwoQPolicy::pushFront(Queue& queue, BufferBlock* block)
+{
+	block->prev = nullptr;
+	block->next = queue.head;
+	if ( queue.head )
+		queue.head->prev = block;
+	else
+		queue.tail = block;
+	queue.head = block;
+	++queue.size;
+
+	block->queue = &queue == &a1in ? A1IN : &queue == &am ? AM : FREE;
+}
+
+void TwoQPolicy::unlink(BufferBlock* block)
+{
+	Queue& queue = queueOf(block);
+
+	if ( block->prev )
+		block->prev->next = block->next;
+	else
+		queue.head = block->next;
+
+	if ( block->next )
+		block->next->prev = block->prev;
+	else
+		queue.tail = block->prev;
+
+	block->next = block->prev = nullptr;
+	--queue.size;
+}
+
+BufferBlock* TwoQPolicy::replaceableFromTail(Queue& queue, bool clean_only, const VictimFilter* filter)
+{
+	for ( BufferBlock* p = queue.tail; p != nullptr; p = p->prev )
+		if ( isReplaceable(p, clean_only, filter) )
+			return p;
+	return nullptr;
+}
+
+/*
+ *  Remember the page of the block in A1out. The oldest one is forgotten
+ *  when A1out holds more than a half of the number of blocks.
+ */
+void TwoQPolicy::remember(BufferBlock* block)
+{
+	if ( block->table_id == 0 )
+		return;
+
+	const uint64_t key = BufferManager::makeKey(block->table_id, block->pgnum);
+	if ( a1out_index.count(key) )
+		return;
+
+	a1out.push_front(key);
+	a1out_index[key] = a1out.begin();
+
+	while ( a1out.size() > std::max<size_t>(size / 2, 1) )
+	{
+		a1out_index.erase(a1out.back());
+		a1out.pop_back();
+	}
+}
+
+void TwoQPolicy::add(BufferBlock* block)
+{
+	++size;
+	block->queue = FREE;
+	pushFront(free_queue, block);
+}
+
+void TwoQPolicy::remove(BufferBlock* block)
+{
+	unlink(block);
+	--size;
+}
+
+void TwoQPolicy::load(BufferBlock* block)
+{
+	const uint64_t key = BufferManager::makeKey(block->table_id, block->pgnum);
+	auto it = a1out_index.find(key);
+
+	unlink(block);
+	if ( it != a1out_index.end() )
+	{
+		/* Referenced again after leaving A1in: it is a hot page. */
+		a1out.erase(it->second);
+		a1out_index.erase(it);
+		pushFront(am, block);
+	}
+	else
+	{
+		pushFront(a1in, block);
+	}
+}
+
+/* A victim may not be claimed in the end, so A1out only learns of a page when it is really evicted. */
+void TwoQPolicy::evict(BufferBlock* block)
+{
+	if ( block->queue == A1IN )
+		remember(block);
+}
+
+void TwoQPolicy::access(BufferBlock* block)
+{
+	/* A correlated reference in A1in doesn't make the page hot. */
+	if ( block->queue == AM )
+	{
+		unlink(block);
+		pushFront(am, block);
+	}
+}
+
+BufferBlock* TwoQPolicy::victim(bool clean_only, const VictimFilter* filter)
+{
+	BufferBlock* p;
+
+	/* Unused blocks first */
+	if ( (p = replaceableFromTail(free_queue, clean_only, filter)) != nullptr )
+		return p;
+
+	/* A1in may hold up to a quarter of the blocks. */
+	if ( a1in.size > std::max<size_t>(size / 4, 1) || am.size == 0 )
+	{
+		if ( (p = replaceableFromTail(a1in, clean_only, filter)) != nullptr )
+			return p;
+	}
+
+	if ( (p = replaceableFromTail(am, clean_only, filter)) != nullptr )
+		return p;
+
+	return replaceableFromTail(a1in, clean_only, filter);
+}
+
+void TwoQPolicy::coldest(std::vector<BufferBlock*>& dest, size_t n)
+{
+	/* A1in is evicted before Am. */
+	for ( BufferBlock* p = a1in.tail; p != nullptr && n; p = p->prev, --n )
+		dest.push_back(p);
+	for ( BufferBlock* p = am.tail; p != nullptr && n; p = p->prev, --n )
+		dest.push_back(p);
+}
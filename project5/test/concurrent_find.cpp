@@ -0,0 +1,78 @@
+#include "bench_util.h"
+
+#include <atomic>
+
+/*
+ *  Lookups running next to a writer must see every record which is not being changed.
+ *  The table holds the even keys, which the readers look up, while the writer inserts and erases
+ *  the odd keys between them, splitting and merging the pages around the even ones.
+ *  It runs with a small pool as well, so that the pages are evicted during the descents.
+ */
+int main(int argc, char** argv)
+{
+	const int64_t num_keys = arg(argc, argv, "keys", 20000);
+	const int num_readers = arg(argc, argv, "threads", 8);
+	const int num_rounds = arg(argc, argv, "rounds", 3);
+	const char* path = "test_concurrent_find.db";
+
+	// The figures are printed here, instead of the statistics dump at shutdown_db().
+	set_buffer_stats_dump(false);
+
+	for (int buf_num : { 64, 100000 }) {
+		if (init_db(buf_num) != 0)
+			fail("init_db");
+		remove_table(path);
+		const int table_id = open_table(const_cast<char*>(path), 3);
+		if (table_id <= 0)
+			fail("open_table(%s) = %d", path, table_id);
+		set_durability(table_id, NO_SYNC);
+
+		int64_t values[2];
+		for (int64_t key = 0; key < num_keys; key++) {
+			record_of(2 * key, values);
+			if (insert(table_id, 2 * key, values) != 0)
+				fail("insert(%lld) failed", (long long)(2 * key));
+		}
+
+		std::atomic<bool> writing(true);
+		std::atomic<long> num_finds(0);
+		run_threads(num_readers + 1, [&](int id) {
+			if (id == num_readers) {
+				int64_t values[2];
+				for (int round = 0; round < num_rounds; round++) {
+					for (int64_t key = 0; key < num_keys; key++) {
+						record_of(2 * key + 1, values);
+						if (insert(table_id, 2 * key + 1, values) != 0)
+							fail("insert(%lld) failed", (long long)(2 * key + 1));
+					}
+					for (int64_t key = 0; key < num_keys; key++) {
+						if (erase(table_id, 2 * key + 1) != 0)
+							fail("erase(%lld) failed", (long long)(2 * key + 1));
+					}
+				}
+				writing = false;
+				return;
+			}
+
+			Random random(id + 1);
+			long n = 0;
+			for (; writing; n++) {
+				const int64_t key = 2 * random.below(num_keys);
+				if (!find_checked(table_id, key))
+					fail("key %lld is missing during an update, with %d buffers", (long long)key, buf_num);
+			}
+			num_finds += n;
+		});
+
+		for (int64_t key = 0; key < 2 * num_keys; key++) {
+			if (find_checked(table_id, key) != (key % 2 == 0))
+				fail("key %lld is %s after the updates", (long long)key, key % 2 ? "present" : "missing");
+		}
+		printf("%d buffers: %ld lookups next to the writer\n", buf_num, num_finds.load());
+
+		close_table(table_id);
+		shutdown_db();
+		remove_table(path);
+	}
+	return 0;
+}
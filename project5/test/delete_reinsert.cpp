@@ -0,0 +1,81 @@
+#include "bench_util.h"
+
+/*
+ *  Erasing keys empties the leaves, which are freed and merged up to the root,
+ *  and inserting them again must find every record in pages which are handed out again.
+ *  Each round erases every key (in ascending order, then in descending order) and inserts them again,
+ *  after the keys of the first half of a small table have been erased next to the other half.
+ *  It runs with a small pool as well, so that the freed pages are read back from the disk.
+ */
+
+/* Check that the keys in [from, to) are all present or all missing. */
+static void check_keys(int table_id, int64_t from, int64_t to, bool present, const char* when)
+{
+	for (int64_t key = from; key < to; key++) {
+		if (find_checked(table_id, key) != present)
+			fail("key %lld is %s %s", (long long)key, present ? "missing" : "present", when);
+	}
+}
+
+static void insert_keys(int table_id, int64_t from, int64_t to)
+{
+	int64_t values[2];
+	for (int64_t key = from; key < to; key++) {
+		record_of(key, values);
+		if (insert(table_id, key, values) != 0)
+			fail("insert(%lld) failed", (long long)key);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const int64_t num_keys = arg(argc, argv, "keys", 20000);
+	const int num_rounds = arg(argc, argv, "rounds", 2);
+	const char* path = "test_delete_reinsert.db";
+
+	// The figures are printed here, instead of the statistics dump at shutdown_db().
+	set_buffer_stats_dump(false);
+
+	for (int buf_num : { 64, 100000 }) {
+		if (init_db(buf_num) != 0)
+			fail("init_db");
+
+		// Half of the leaves are emptied, and the next inserts split the others.
+		int table_id = load_table(path, 32);
+		for (int64_t key = 0; key < 16; key++) {
+			if (erase(table_id, key) != 0)
+				fail("erase(%lld) failed", (long long)key);
+		}
+		insert_keys(table_id, 100, 400);
+		check_keys(table_id, 0, 16, false, "after it is erased");
+		check_keys(table_id, 16, 32, true, "next to the erased keys");
+		check_keys(table_id, 100, 400, true, "after the erased keys");
+		close_table(table_id);
+
+		table_id = load_table(path, num_keys);
+		for (int round = 0; round < num_rounds; round++) {
+			for (int64_t i = 0; i < num_keys; i++) {
+				const int64_t key = round % 2 == 0 ? i : num_keys - 1 - i;
+				if (erase(table_id, key) != 0)
+					fail("erase(%lld) failed in round %d", (long long)key, round);
+			}
+			check_keys(table_id, 0, num_keys, false, "after every key is erased");
+
+			insert_keys(table_id, 0, num_keys);
+			check_keys(table_id, 0, num_keys, true, "after every key is inserted again");
+		}
+
+		// The records are on the disk as well.
+		close_table(table_id);
+		table_id = open_table(const_cast<char*>(path), 3);
+		if (table_id <= 0)
+			fail("open_table(%s) = %d", path, table_id);
+		check_keys(table_id, 0, num_keys, true, "after the table is reopened");
+		printf("%d buffers: %lld keys erased and inserted again %d times\n", buf_num, (long long)num_keys, num_rounds);
+
+		close_table(table_id);
+		shutdown_db();
+		remove_table(path);
+	}
+	return 0;
+}